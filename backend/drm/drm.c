@@ -28,6 +28,8 @@
 #include "backend/drm/iface.h"
 #include "backend/drm/util.h"
 #include "util/signal.h"
+#include "util/trace.h"
+#include "util/time.h"
 
 bool check_drm_features(struct wlr_drm_backend *drm) {
 	uint64_t cap;
@@ -406,6 +408,7 @@ static bool drm_connector_commit(struct wlr_output *output) {
 	}
 
 	conn->pageflip_pending = true;
+	conn->pageflip_commit_seq = output->commit_seq;
 	if (output->pending.buffer_type == WLR_OUTPUT_STATE_BUFFER_SCANOUT) {
 		wlr_buffer_unref(conn->pending_buffer);
 		conn->pending_buffer = wlr_buffer_ref(output->pending.buffer);
@@ -497,6 +500,9 @@ static bool drm_connector_export_dmabuf(struct wlr_output *output,
 	}
 	struct wlr_drm_plane *plane = crtc->primary;
 	struct wlr_drm_surface *surf = &plane->surf;
+	if (surf->back == NULL) {
+		return false;
+	}
 
 	return export_drm_bo(surf->back, attribs);
 }
@@ -1442,12 +1448,10 @@ void scan_drm_connectors(struct wlr_drm_backend *drm) {
 	attempt_enable_needs_modeset(drm);
 }
 
-static int mhz_to_nsec(int mhz) {
-	return 1000000000000LL / mhz;
-}
-
 static void page_flip_handler(int fd, unsigned seq,
 		unsigned tv_sec, unsigned tv_usec, unsigned crtc_id, void *data) {
+	trace_point(WLR_TRACE_PAGE_FLIP, crtc_id);
+
 	struct wlr_drm_backend *drm = data;
 	struct wlr_drm_connector *conn = NULL;
 	struct wlr_drm_connector *search;
@@ -1501,6 +1505,7 @@ static void page_flip_handler(int fd, unsigned seq,
 		.seq = seq,
 		.refresh = mhz_to_nsec(conn->output.refresh),
 		.flags = present_flags,
+		.commit_seq = conn->pageflip_commit_seq,
 	};
 	wlr_output_send_present(&conn->output, &present_event);
 
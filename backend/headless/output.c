@@ -5,6 +5,7 @@
 #include <wlr/util/log.h>
 #include "backend/headless.h"
 #include "util/signal.h"
+#include "util/time.h"
 
 static struct wlr_headless_output *headless_output_from_output(
 		struct wlr_output *wlr_output) {
@@ -58,8 +59,12 @@ static bool output_attach_render(struct wlr_output *wlr_output,
 }
 
 static bool output_commit(struct wlr_output *wlr_output) {
-	// Nothing needs to be done for pbuffers
-	wlr_output_send_present(wlr_output, NULL);
+	struct wlr_headless_output *output =
+		headless_output_from_output(wlr_output);
+	// Nothing needs to be done for pbuffers, the contents are presented on
+	// the next tick of the frame timer, which acts as the vblank
+	output->present_pending = true;
+	output->present_commit_seq = wlr_output->commit_seq;
 	return true;
 }
 
@@ -88,6 +93,17 @@ bool wlr_output_is_headless(struct wlr_output *wlr_output) {
 
 static int signal_frame(void *data) {
 	struct wlr_headless_output *output = data;
+	output->frame_seq++;
+	if (output->present_pending) {
+		output->present_pending = false;
+		struct wlr_output_event_present present_event = {
+			.seq = output->frame_seq,
+			.refresh = mhz_to_nsec(output->wlr_output.refresh),
+			.flags = WLR_OUTPUT_PRESENT_VSYNC,
+			.commit_seq = output->present_commit_seq,
+		};
+		wlr_output_send_present(&output->wlr_output, &present_event);
+	}
 	wlr_output_send_frame(&output->wlr_output);
 	wl_event_source_timer_update(output->frame_timer, output->frame_delay);
 	return 0;
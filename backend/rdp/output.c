@@ -1,7 +1,9 @@
 #include <assert.h>
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
+#include <inttypes.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/interfaces/wlr_output.h>
@@ -9,6 +11,7 @@
 #include <wlr/render/wlr_renderer.h>
 #include "backend/rdp.h"
 #include "util/signal.h"
+#include "util/time.h"
 
 static struct wlr_rdp_output *rdp_output_from_output(
 		struct wlr_output *wlr_output) {
@@ -166,6 +169,54 @@ static bool nsc_swap_buffers(
 	return true;
 }
 
+static void output_send_present(struct wlr_rdp_output *output,
+		uint32_t commit_seq, uint32_t flags) {
+	struct wlr_output_event_present present_event = {
+		.seq = ++output->present_seq,
+		.refresh = mhz_to_nsec(output->wlr_output.refresh),
+		.flags = flags,
+		.commit_seq = commit_seq,
+	};
+	wlr_output_send_present(&output->wlr_output, &present_event);
+}
+
+static void output_push_pending_frame(struct wlr_rdp_output *output,
+		uint32_t frame_id, uint32_t commit_seq) {
+	if (output->pending_frames_len == RDP_MAX_PENDING_FRAMES) {
+		// The oldest frame is superseded by the ones after it anyway
+		memmove(&output->pending_frames[0], &output->pending_frames[1],
+			(output->pending_frames_len - 1) *
+			sizeof(output->pending_frames[0]));
+		output->pending_frames_len--;
+	}
+	output->pending_frames[output->pending_frames_len++] =
+		(struct wlr_rdp_pending_frame){
+			.frame_id = frame_id,
+			.commit_seq = commit_seq,
+		};
+}
+
+void rdp_output_ack_frame(struct wlr_rdp_output *output, uint32_t frame_id) {
+	size_t i = 0;
+	while (i < output->pending_frames_len &&
+			output->pending_frames[i].frame_id != frame_id) {
+		i++;
+	}
+	if (i == output->pending_frames_len) {
+		wlr_log(WLR_DEBUG, "Ignoring acknowledgement of unknown frame %"PRIu32,
+			frame_id);
+		return;
+	}
+
+	// Frames are displayed in order, the ones before have been replaced
+	uint32_t commit_seq = output->pending_frames[i].commit_seq;
+	output->pending_frames_len -= i + 1;
+	memmove(&output->pending_frames[0], &output->pending_frames[i + 1],
+		output->pending_frames_len * sizeof(output->pending_frames[0]));
+
+	output_send_present(output, commit_seq, WLR_OUTPUT_PRESENT_HW_COMPLETION);
+}
+
 static bool output_commit(struct wlr_output *wlr_output) {
 	struct wlr_rdp_output *output =
 		rdp_output_from_output(wlr_output);
@@ -181,6 +232,19 @@ static bool output_commit(struct wlr_output *wlr_output) {
 		damage = &wlr_output->pending.damage;
 	}
 
+	if (!pixman_region32_not_empty(damage)) {
+		// Nothing to send, the peer already shows these contents, or will
+		// once the frames it hasn't acknowledged yet are displayed
+		if (output->pending_frames_len > 0) {
+			output->pending_frames[output->pending_frames_len - 1].commit_seq =
+				wlr_output->commit_seq;
+		} else {
+			output_send_present(output, wlr_output->commit_seq, 0);
+		}
+		ret = true;
+		goto out;
+	}
+
 	int x = damage->extents.x1;
 	int y = damage->extents.y1;
 	int width = damage->extents.x2 - damage->extents.x1;
@@ -198,8 +262,15 @@ static bool output_commit(struct wlr_output *wlr_output) {
 		goto out;
 	}
 
-	// Send along to clients
-	rdpSettings *settings = output->context->peer->settings;
+	// Send along to clients, wrapped in a surface frame so that the peer can
+	// tell us when it's done with it
+	freerdp_peer *peer = output->context->peer;
+	rdpSettings *settings = peer->settings;
+	SURFACE_FRAME_MARKER marker = {
+		.frameAction = SURFACECMD_FRAMEACTION_BEGIN,
+		.frameId = ++output->frame_id,
+	};
+	peer->update->SurfaceFrameMarker(peer->context, &marker);
 	if (settings->RemoteFxCodec) {
 		ret = rfx_swap_buffers(output, damage);
 	} else if (settings->NSCodec) {
@@ -209,11 +280,20 @@ static bool output_commit(struct wlr_output *wlr_output) {
 		wlr_log(WLR_ERROR, "Raw updates are not supported; use rfx or nsc");
 		ret = false;
 	}
+	marker.frameAction = SURFACECMD_FRAMEACTION_END;
+	peer->update->SurfaceFrameMarker(peer->context, &marker);
 	if (!ret) {
 		goto out;
 	}
 
-	wlr_output_send_present(wlr_output, NULL);
+	if (settings->FrameAcknowledge == 0) {
+		// The peer doesn't acknowledge frames, the best we can do is to
+		// assume it's presented as soon as it's sent
+		output_send_present(output, wlr_output->commit_seq, 0);
+	} else {
+		output_push_pending_frame(output, marker.frameId,
+			wlr_output->commit_seq);
+	}
 
 out:
 	pixman_region32_fini(&output_region);
@@ -9,6 +9,7 @@
 #include <wlr/util/log.h>
 #include "backend/rdp.h"
 #include "util/signal.h"
+#include "util/time.h"
 
 static BOOL xf_peer_capabilities(freerdp_peer *client) {
 	return TRUE;
@@ -80,6 +81,20 @@ static int xf_suppress_output(rdpContext *context,
 	return true;
 }
 
+static int xf_surface_frame_acknowledge(rdpContext *context,
+		UINT32 frame_id) {
+	struct wlr_rdp_peer_context *peer_context =
+		(struct wlr_rdp_peer_context *)context;
+	// The peer may ask us to stop waiting for acknowledgements by sending an
+	// invalid frame ID, in which case there is nothing to report
+	if (frame_id == UINT32_MAX || peer_context->output == NULL) {
+		return true;
+	}
+	// The peer is done decoding and displaying the frame
+	rdp_output_ack_frame(peer_context->output, frame_id);
+	return true;
+}
+
 static int xf_input_synchronize_event(rdpInput *input, UINT32 flags) {
 	struct wlr_rdp_peer_context *context =
 		(struct wlr_rdp_peer_context *)input->context;
@@ -105,6 +120,7 @@ static int xf_input_mouse_event(rdpInput *input,
 		struct wlr_event_pointer_motion_absolute event = { 0 };
 		event.device = wlr_device;
 		event.time_msec = timespec_to_msec(&now);
+		event.time_nsec = timespec_to_nsec(&now);
 		event.x = x / (double)context->output->wlr_output.width;
 		event.y = y / (double)context->output->wlr_output.height;
 		wlr_signal_emit_safe(&pointer->events.motion_absolute, &event);
@@ -124,6 +140,7 @@ static int xf_input_mouse_event(rdpInput *input,
 		struct wlr_event_pointer_button event = { 0 };
 		event.device = wlr_device;
 		event.time_msec = timespec_to_msec(&now);
+		event.time_nsec = timespec_to_nsec(&now);
 		event.button = button;
 		event.state = (flags & PTR_FLAGS_DOWN) ?
 			WLR_BUTTON_PRESSED : WLR_BUTTON_RELEASED;
@@ -139,6 +156,7 @@ static int xf_input_mouse_event(rdpInput *input,
 		struct wlr_event_pointer_axis event = { 0 };
 		event.device = &context->pointer->wlr_input_device;
 		event.time_msec = timespec_to_msec(&now);
+		event.time_nsec = timespec_to_nsec(&now);
 		event.source = WLR_AXIS_SOURCE_WHEEL;
 		event.orientation = WLR_AXIS_ORIENTATION_VERTICAL;
 		event.delta = value;
@@ -165,6 +183,7 @@ static int xf_input_extended_mouse_event(
 	struct wlr_event_pointer_motion_absolute event = { 0 };
 	event.device = wlr_device;
 	event.time_msec = timespec_to_msec(&now);
+	event.time_nsec = timespec_to_nsec(&now);
 	event.x = x / (double)context->output->wlr_output.width;
 	event.y = y / (double)context->output->wlr_output.height;
 	wlr_signal_emit_safe(&pointer->events.motion_absolute, &event);
@@ -207,6 +226,7 @@ static int xf_input_keyboard_event(rdpInput *input, UINT16 flags, UINT16 code) {
 				vk_code, KEYCODE_TYPE_EVDEV);
 		struct wlr_event_keyboard_key event = { 0 };
 		event.time_msec = timespec_to_msec(&now);
+		event.time_nsec = timespec_to_nsec(&now);
 		event.keycode = scan_code - 8;
 		event.state = state;
 		event.update_state = true;
@@ -325,6 +345,8 @@ int rdp_peer_init(freerdp_peer *client,
 	client->Activate = xf_peer_activate;
 
 	client->update->SuppressOutput = (pSuppressOutput)xf_suppress_output;
+	client->update->SurfaceFrameAcknowledge =
+		(pSurfaceFrameAcknowledge)xf_surface_frame_acknowledge;
 
 	client->input->SynchronizeEvent = xf_input_synchronize_event;
 	client->input->MouseEvent = xf_input_mouse_event;
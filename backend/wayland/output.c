@@ -17,6 +17,7 @@
 #include "backend/wayland.h"
 #include "util/signal.h"
 #include "linux-dmabuf-unstable-v1-client-protocol.h"
+#include "presentation-time-client-protocol.h"
 #include "xdg-decoration-unstable-v1-client-protocol.h"
 #include "xdg-shell-client-protocol.h"
 
@@ -42,6 +43,56 @@ static struct wl_callback_listener frame_listener = {
 	.done = surface_frame_callback
 };
 
+static void presentation_feedback_destroy(
+		struct wlr_wl_presentation_feedback *feedback) {
+	wl_list_remove(&feedback->link);
+	wp_presentation_feedback_destroy(feedback->feedback);
+	free(feedback);
+}
+
+static void presentation_feedback_handle_sync_output(void *data,
+		struct wp_presentation_feedback *feedback, struct wl_output *output) {
+	// This space is intentionally left blank
+}
+
+static void presentation_feedback_handle_presented(void *data,
+		struct wp_presentation_feedback *wp_feedback, uint32_t tv_sec_hi,
+		uint32_t tv_sec_lo, uint32_t tv_nsec, uint32_t refresh_ns,
+		uint32_t seq_hi, uint32_t seq_lo, uint32_t flags) {
+	struct wlr_wl_presentation_feedback *feedback = data;
+
+	struct timespec when = {
+		.tv_sec = ((uint64_t)tv_sec_hi << 32) | tv_sec_lo,
+		.tv_nsec = tv_nsec,
+	};
+	// The presentation-time flags match enum wlr_output_present_flag
+	struct wlr_output_event_present present_event = {
+		.when = &when,
+		.seq = ((uint64_t)seq_hi << 32) | seq_lo,
+		.refresh = refresh_ns,
+		.flags = flags,
+		.commit_seq = feedback->commit_seq,
+	};
+	wlr_output_send_present(&feedback->output->wlr_output, &present_event);
+
+	presentation_feedback_destroy(feedback);
+}
+
+static void presentation_feedback_handle_discarded(void *data,
+		struct wp_presentation_feedback *wp_feedback) {
+	struct wlr_wl_presentation_feedback *feedback = data;
+	// The frame never reached the screen, surfaces will be reported as
+	// presented along with the next frame which does
+	presentation_feedback_destroy(feedback);
+}
+
+static const struct wp_presentation_feedback_listener
+		presentation_feedback_listener = {
+	.sync_output = presentation_feedback_handle_sync_output,
+	.presented = presentation_feedback_handle_presented,
+	.discarded = presentation_feedback_handle_discarded,
+};
+
 static bool output_set_custom_mode(struct wlr_output *wlr_output,
 		int32_t width, int32_t height, int32_t refresh) {
 	struct wlr_wl_output *output = get_wl_output_from_output(wlr_output);
@@ -125,6 +176,23 @@ static bool output_commit(struct wlr_output *wlr_output) {
 	output->frame_callback = wl_surface_frame(output->surface);
 	wl_callback_add_listener(output->frame_callback, &frame_listener, output);
 
+	// Feedback applies to the next surface commit, which happens below
+	struct wlr_wl_presentation_feedback *feedback = NULL;
+	if (output->backend->presentation != NULL) {
+		feedback = calloc(1, sizeof(struct wlr_wl_presentation_feedback));
+		if (feedback == NULL) {
+			wlr_log(WLR_ERROR, "Allocation failed");
+		} else {
+			feedback->output = output;
+			feedback->commit_seq = wlr_output->commit_seq;
+			feedback->feedback = wp_presentation_feedback(
+				output->backend->presentation, output->surface);
+			wp_presentation_feedback_add_listener(feedback->feedback,
+				&presentation_feedback_listener, feedback);
+			wl_list_insert(&output->presentation_feedbacks, &feedback->link);
+		}
+	}
+
 	pixman_region32_t *damage = NULL;
 	if (wlr_output->pending.committed & WLR_OUTPUT_STATE_DAMAGE) {
 		damage = &wlr_output->pending.damage;
@@ -142,6 +210,9 @@ static bool output_commit(struct wlr_output *wlr_output) {
 	case WLR_OUTPUT_STATE_BUFFER_RENDER:
 		if (!wlr_egl_swap_buffers(&output->backend->egl,
 				output->egl_surface, damage)) {
+			if (feedback != NULL) {
+				presentation_feedback_destroy(feedback);
+			}
 			return false;
 		}
 		break;
@@ -167,8 +238,9 @@ static bool output_commit(struct wlr_output *wlr_output) {
 		break;
 	}
 
-	// TODO: if available, use the presentation-time protocol
-	wlr_output_send_present(wlr_output, NULL);
+	if (feedback == NULL) {
+		wlr_output_send_present(wlr_output, NULL);
+	}
 
 	return true;
 }
@@ -267,6 +339,12 @@ static void output_destroy(struct wlr_output *wlr_output) {
 		wl_callback_destroy(output->frame_callback);
 	}
 
+	struct wlr_wl_presentation_feedback *feedback, *feedback_tmp;
+	wl_list_for_each_safe(feedback, feedback_tmp,
+			&output->presentation_feedbacks, link) {
+		presentation_feedback_destroy(feedback);
+	}
+
 	wlr_egl_destroy_surface(&output->backend->egl, output->egl_surface);
 	wl_egl_window_destroy(output->egl_window);
 	if (output->zxdg_toplevel_decoration_v1) {
@@ -383,6 +461,7 @@ struct wlr_output *wlr_wl_output_create(struct wlr_backend *wlr_backend) {
 		++backend->last_output_num);
 
 	output->backend = backend;
+	wl_list_init(&output->presentation_feedbacks);
 
 	output->surface = wl_compositor_create_surface(backend->compositor);
 	if (!output->surface) {
@@ -18,6 +18,7 @@
 #include "pointer-gestures-unstable-v1-client-protocol.h"
 #include "backend/wayland.h"
 #include "util/signal.h"
+#include "util/time.h"
 
 static struct wlr_wl_pointer *output_get_pointer(struct wlr_wl_output *output) {
 	struct wlr_input_device *wlr_dev;
@@ -82,6 +83,7 @@ static void pointer_handle_motion(void *data, struct wl_pointer *wl_pointer,
 	struct wlr_event_pointer_motion_absolute event = {
 		.device = &pointer->input_device->wlr_input_device,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.x = wl_fixed_to_double(sx) / wlr_output->width,
 		.y = wl_fixed_to_double(sy) / wlr_output->height,
 	};
@@ -101,6 +103,7 @@ static void pointer_handle_button(void *data, struct wl_pointer *wl_pointer,
 		.button = button,
 		.state = state,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 	};
 	wlr_signal_emit_safe(&pointer->wlr_pointer.events.button, &event);
 }
@@ -119,6 +122,7 @@ static void pointer_handle_axis(void *data, struct wl_pointer *wl_pointer,
 		.delta_discrete = pointer->axis_discrete,
 		.orientation = axis,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.source = pointer->axis_source,
 	};
 	wlr_signal_emit_safe(&pointer->wlr_pointer.events.axis, &event);
@@ -162,6 +166,7 @@ static void pointer_handle_axis_stop(void *data, struct wl_pointer *wl_pointer,
 		.delta_discrete = 0,
 		.orientation = axis,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.source = pointer->axis_source,
 	};
 	wlr_signal_emit_safe(&pointer->wlr_pointer.events.axis, &event);
@@ -213,6 +218,7 @@ static void keyboard_handle_enter(void *data, struct wl_keyboard *wl_keyboard,
 			.keycode = *keycode_ptr,
 			.state = WLR_KEY_PRESSED,
 			.time_msec = time,
+			.time_nsec = get_current_time_nsec(),
 			.update_state = false,
 		};
 		wlr_keyboard_notify_key(dev->keyboard, &event);
@@ -236,6 +242,7 @@ static void keyboard_handle_leave(void *data, struct wl_keyboard *wl_keyboard,
 			.keycode = keycode,
 			.state = WLR_KEY_RELEASED,
 			.time_msec = time,
+			.time_nsec = get_current_time_nsec(),
 			.update_state = false,
 		};
 		wlr_keyboard_notify_key(dev->keyboard, &event);
@@ -251,6 +258,7 @@ static void keyboard_handle_key(void *data, struct wl_keyboard *wl_keyboard,
 		.keycode = key,
 		.state = state,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.update_state = false,
 	};
 	wlr_keyboard_notify_key(dev->keyboard, &wlr_event);
@@ -354,6 +362,7 @@ static void gesture_swipe_begin(void *data,
 	struct wlr_event_pointer_swipe_begin wlr_event = {
 		.device = wlr_dev,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.fingers = fingers,
 	};
 	input_device->fingers = fingers;
@@ -368,6 +377,7 @@ static void gesture_swipe_update(void *data,
 	struct wlr_event_pointer_swipe_update wlr_event = {
 		.device = wlr_dev,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.fingers = input_device->fingers,
 		.dx = wl_fixed_to_double(dx),
 		.dy = wl_fixed_to_double(dy),
@@ -383,6 +393,7 @@ static void gesture_swipe_end(void *data,
 	struct wlr_event_pointer_swipe_end wlr_event = {
 		.device = wlr_dev,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.cancelled = cancelled,
 	};
 	wlr_signal_emit_safe(&wlr_dev->pointer->events.swipe_end, &wlr_event);
@@ -403,6 +414,7 @@ static void gesture_pinch_begin(void *data,
 	struct wlr_event_pointer_pinch_begin wlr_event = {
 		.device = wlr_dev,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.fingers = fingers,
 	};
 	input_device->fingers = fingers;
@@ -417,6 +429,7 @@ static void gesture_pinch_update(void *data,
 	struct wlr_event_pointer_pinch_update wlr_event = {
 		.device = wlr_dev,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.fingers = input_device->fingers,
 		.dx = wl_fixed_to_double(dx),
 		.dy = wl_fixed_to_double(dy),
@@ -434,6 +447,7 @@ static void gesture_pinch_end(void *data,
 	struct wlr_event_pointer_pinch_end wlr_event = {
 		.device = wlr_dev,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.cancelled = cancelled,
 	};
 	wlr_signal_emit_safe(&wlr_dev->pointer->events.pinch_end, &wlr_event);
@@ -12,6 +12,7 @@
 #include <X11/Xlib-xcb.h>
 #include <wayland-server-core.h>
 #include <xcb/xcb.h>
+#include <xcb/present.h>
 #include <xcb/xfixes.h>
 #include <xcb/xinput.h>
 
@@ -75,6 +76,9 @@ static void handle_x11_event(struct wlr_x11_backend *x11,
 		xcb_ge_generic_event_t *ev = (xcb_ge_generic_event_t *)event;
 		if (ev->extension == x11->xinput_opcode) {
 			handle_x11_xinput_event(x11, ev);
+		} else if (x11->present_opcode != 0 &&
+				ev->extension == x11->present_opcode) {
+			handle_x11_present_event(x11, ev);
 		}
 	}
 	}
@@ -261,6 +265,14 @@ struct wlr_backend *wlr_x11_backend_create(struct wl_display *display,
 	}
 	free(xi_reply);
 
+	ext = xcb_get_extension_data(x11->xcb, &xcb_present_id);
+	if (ext && ext->present) {
+		x11->present_opcode = ext->major_opcode;
+	} else {
+		wlr_log(WLR_INFO, "X11 does not support Present extension, "
+			"presentation timestamps will be estimated");
+	}
+
 	int fd = xcb_get_file_descriptor(x11->xcb);
 	struct wl_event_loop *ev = wl_display_get_event_loop(display);
 	uint32_t events = WL_EVENT_READABLE | WL_EVENT_ERROR | WL_EVENT_HANGUP;
@@ -16,11 +16,13 @@
 
 #include "backend/x11.h"
 #include "util/signal.h"
+#include "util/time.h"
 
 static void send_key_event(struct wlr_x11_backend *x11, uint32_t key,
 		enum wlr_key_state st, xcb_timestamp_t time) {
 	struct wlr_event_keyboard_key ev = {
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.keycode = key,
 		.state = st,
 		.update_state = true,
@@ -33,6 +35,7 @@ static void send_button_event(struct wlr_x11_output *output, uint32_t key,
 	struct wlr_event_pointer_button ev = {
 		.device = &output->pointer_dev,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.button = key,
 		.state = st,
 	};
@@ -45,6 +48,7 @@ static void send_axis_event(struct wlr_x11_output *output, int32_t delta,
 	struct wlr_event_pointer_axis ev = {
 		.device = &output->pointer_dev,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.source = WLR_AXIS_SOURCE_WHEEL,
 		.orientation = WLR_AXIS_ORIENTATION_VERTICAL,
 		// 15 is a typical value libinput sends for one scroll
@@ -60,6 +64,7 @@ static void send_pointer_position_event(struct wlr_x11_output *output,
 	struct wlr_event_pointer_motion_absolute ev = {
 		.device = &output->pointer_dev,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.x = (double)x / output->wlr_output.width,
 		.y = (double)y / output->wlr_output.height,
 	};
@@ -72,6 +77,7 @@ static void send_touch_down_event(struct wlr_x11_output *output,
 	struct wlr_event_touch_down ev = {
 		.device = &output->touch_dev,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.x = (double)x / output->wlr_output.width,
 		.y = (double)y / output->wlr_output.height,
 		.touch_id = touch_id,
@@ -84,6 +90,7 @@ static void send_touch_motion_event(struct wlr_x11_output *output,
 	struct wlr_event_touch_motion ev = {
 		.device = &output->touch_dev,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.x = (double)x / output->wlr_output.width,
 		.y = (double)y / output->wlr_output.height,
 		.touch_id = touch_id,
@@ -96,6 +103,7 @@ static void send_touch_up_event(struct wlr_x11_output *output,
 	struct wlr_event_touch_up ev = {
 		.device = &output->touch_dev,
 		.time_msec = time,
+		.time_nsec = get_current_time_nsec(),
 		.touch_id = touch_id,
 	};
 	wlr_signal_emit_safe(&output->touch.events.up, &ev);
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <xcb/present.h>
 #include <xcb/xcb.h>
 #include <xcb/xinput.h>
 
@@ -14,9 +15,35 @@
 
 #include "backend/x11.h"
 #include "util/signal.h"
+#include "util/time.h"
+
+// Swaps complete in order, `pending` is the number of swaps still waiting
+// after the one being reported
+static uint32_t output_present_commit_seq(struct wlr_x11_output *output,
+		int pending) {
+	return output->last_commit_seq - pending;
+}
+
+static void output_send_estimated_present(struct wlr_x11_output *output) {
+	struct wlr_output_event_present present_event = {
+		.refresh = mhz_to_nsec(output->wlr_output.refresh),
+		.commit_seq = output_present_commit_seq(output,
+			output->present_pending),
+	};
+	wlr_output_send_present(&output->wlr_output, &present_event);
+}
 
 static int signal_frame(void *data) {
 	struct wlr_x11_output *output = data;
+	if (output->present_pending > 0 && ++output->present_missed_ticks > 1) {
+		// The X server hasn't reported the swaps in time, most likely because
+		// the EGL implementation doesn't use the Present extension
+		while (output->present_pending > 0) {
+			output->present_pending--;
+			output_send_estimated_present(output);
+		}
+		output->present_missed_ticks = 0;
+	}
 	wlr_output_send_frame(&output->wlr_output);
 	wl_event_source_timer_update(output->frame_timer, output->frame_delay);
 	return 0;
@@ -111,11 +138,60 @@ static bool output_commit(struct wlr_output *wlr_output) {
 	if (!wlr_egl_swap_buffers(&x11->egl, output->surf, damage)) {
 		return false;
 	}
+	output->last_commit_seq = wlr_output->commit_seq;
 
-	wlr_output_send_present(wlr_output, NULL);
+	if (x11->present_opcode != 0) {
+		// Wait for the X server to tell us when the swap completes
+		if (output->present_pending++ == 0) {
+			output->present_missed_ticks = 0;
+		}
+	} else {
+		output_send_estimated_present(output);
+	}
 	return true;
 }
 
+void handle_x11_present_event(struct wlr_x11_backend *x11,
+		xcb_ge_generic_event_t *event) {
+	if (event->event_type != XCB_PRESENT_COMPLETE_NOTIFY) {
+		return;
+	}
+
+	xcb_present_complete_notify_event_t *complete =
+		(xcb_present_complete_notify_event_t *)event;
+	if (complete->kind != XCB_PRESENT_COMPLETE_KIND_PIXMAP) {
+		return;
+	}
+
+	struct wlr_x11_output *output =
+		get_x11_output_from_window_id(x11, complete->window);
+	if (output == NULL || output->present_pending == 0) {
+		return;
+	}
+	output->present_pending--;
+	output->present_missed_ticks = 0;
+
+	// UST is in microseconds, from CLOCK_MONOTONIC
+	struct timespec when = {
+		.tv_sec = complete->ust / 1000000,
+		.tv_nsec = (complete->ust % 1000000) * 1000,
+	};
+	uint32_t flags = WLR_OUTPUT_PRESENT_HW_CLOCK |
+		WLR_OUTPUT_PRESENT_HW_COMPLETION;
+	if (complete->mode != XCB_PRESENT_COMPLETE_MODE_SKIP) {
+		flags |= WLR_OUTPUT_PRESENT_VSYNC;
+	}
+	struct wlr_output_event_present present_event = {
+		.when = &when,
+		.seq = complete->msc,
+		.refresh = mhz_to_nsec(output->wlr_output.refresh),
+		.flags = flags,
+		.commit_seq = output_present_commit_seq(output,
+			output->present_pending),
+	};
+	wlr_output_send_present(&output->wlr_output, &present_event);
+}
+
 static const struct wlr_output_impl output_impl = {
 	.set_custom_mode = output_set_custom_mode,
 	.destroy = output_destroy,
@@ -176,6 +252,13 @@ struct wlr_output *wlr_x11_output_create(struct wlr_backend *backend) {
 	};
 	xcb_input_xi_select_events(x11->xcb, output->win, 1, &xinput_mask.head);
 
+	if (x11->present_opcode != 0) {
+		// Swaps done by the EGL implementation through the Present extension
+		// are reported to all clients listening on the window
+		xcb_present_select_input(x11->xcb, xcb_generate_id(x11->xcb),
+			output->win, XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY);
+	}
+
 	output->surf = wlr_egl_create_surface(&x11->egl, &output->win);
 	if (!output->surf) {
 		wlr_log(WLR_ERROR, "Failed to create EGL surface");
@@ -124,6 +124,7 @@ struct wlr_drm_connector {
 	drmModeCrtc *old_crtc;
 
 	bool pageflip_pending;
+	uint32_t pageflip_commit_seq; // last commit which scheduled a page-flip
 	struct wl_event_source *retry_pageflip;
 	struct wl_list link;
 
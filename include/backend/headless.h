@@ -27,6 +27,9 @@ struct wlr_headless_output {
 	void *egl_surface;
 	struct wl_event_source *frame_timer;
 	int frame_delay; // ms
+	unsigned frame_seq; // number of frame timer ticks so far
+	bool present_pending; // a commit is waiting for the next tick
+	uint32_t present_commit_seq; // commit waiting for the next tick
 };
 
 struct wlr_headless_input_device {
@@ -21,6 +21,14 @@
 
 struct wlr_rdp_peer_context;
 
+// Surface frames sent to the peer whose acknowledgement can be waited for
+#define RDP_MAX_PENDING_FRAMES 8
+
+struct wlr_rdp_pending_frame {
+	uint32_t frame_id;
+	uint32_t commit_seq; // latest commit showing the frame's contents
+};
+
 struct wlr_rdp_output {
 	struct wlr_output wlr_output;
 	struct wlr_rdp_backend *backend;
@@ -30,6 +38,12 @@ struct wlr_rdp_output {
 	pixman_image_t *shadow_surface;
 	struct wl_event_source *frame_timer;
 	int frame_delay; // ms
+
+	uint32_t frame_id; // ID of the last surface frame sent to the peer
+	unsigned present_seq; // number of frames presented so far
+	// Frames waiting to be acknowledged by the peer, oldest first
+	struct wlr_rdp_pending_frame pending_frames[RDP_MAX_PENDING_FRAMES];
+	size_t pending_frames_len;
 };
 
 struct wlr_rdp_input_device {
@@ -87,6 +101,7 @@ struct wlr_rdp_backend *rdp_backend_from_backend(
 	struct wlr_backend *wlr_backend);
 bool rdp_configure_listener(struct wlr_rdp_backend *backend);
 int rdp_peer_init(freerdp_peer *client, struct wlr_rdp_backend *backend);
+void rdp_output_ack_frame(struct wlr_rdp_output *output, uint32_t frame_id);
 struct wlr_rdp_output *wlr_rdp_output_create(struct wlr_rdp_backend *backend,
 		struct wlr_rdp_peer_context *context, unsigned int width,
 		unsigned int height);
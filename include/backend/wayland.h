@@ -2,6 +2,7 @@
 #define BACKEND_WAYLAND_H
 
 #include <stdbool.h>
+#include <time.h>
 
 #include <wayland-client.h>
 #include <wayland-egl.h>
@@ -36,6 +37,8 @@ struct wlr_wl_backend {
 	struct zxdg_decoration_manager_v1 *zxdg_decoration_manager_v1;
 	struct zwp_pointer_gestures_v1 *zwp_pointer_gestures_v1;
 	struct zwp_linux_dmabuf_v1 *zwp_linux_dmabuf_v1;
+	struct wp_presentation *presentation;
+	clockid_t presentation_clock;
 	struct wl_seat *seat;
 	struct wl_pointer *pointer;
 	struct wl_keyboard *keyboard;
@@ -60,6 +63,7 @@ struct wlr_wl_output {
 	EGLSurface egl_surface;
 	struct wl_buffer *pending_wl_buffer, *current_wl_buffer;
 	struct wlr_buffer *current_buffer;
+	struct wl_list presentation_feedbacks; // wlr_wl_presentation_feedback::link
 
 	uint32_t enter_serial;
 
@@ -71,6 +75,13 @@ struct wlr_wl_output {
 	} cursor;
 };
 
+struct wlr_wl_presentation_feedback {
+	struct wlr_wl_output *output;
+	struct wl_list link; // wlr_wl_output::presentation_feedbacks
+	struct wp_presentation_feedback *feedback;
+	uint32_t commit_seq;
+};
+
 struct wlr_wl_input_device {
 	struct wlr_input_device wlr_input_device;
 	uint32_t fingers;
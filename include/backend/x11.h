@@ -38,6 +38,14 @@ struct wlr_x11_output {
 	struct wl_event_source *frame_timer;
 	int frame_delay;
 
+	// Swaps waiting for a Present CompleteNotify event
+	int present_pending;
+	// Commit of the last swap, the pending ones are the ones before it
+	uint32_t last_commit_seq;
+	// Frame timer ticks since the last CompleteNotify event, used to detect
+	// swaps which don't go through the Present extension
+	int present_missed_ticks;
+
 	bool cursor_hidden;
 };
 
@@ -78,6 +86,7 @@ struct wlr_x11_backend {
 	xcb_timestamp_t time;
 
 	uint8_t xinput_opcode;
+	uint8_t present_opcode; // 0 if the Present extension is unavailable
 
 	struct wl_listener display_destroy;
 };
@@ -99,5 +108,7 @@ void update_x11_pointer_position(struct wlr_x11_output *output,
 
 void handle_x11_configure_notify(struct wlr_x11_output *output,
 	xcb_configure_notify_event_t *event);
+void handle_x11_present_event(struct wlr_x11_backend *x11,
+	xcb_ge_generic_event_t *event);
 
 #endif
@@ -0,0 +1,32 @@
+#ifndef TYPES_WLR_SURFACE_H
+#define TYPES_WLR_SURFACE_H
+
+#include <stdbool.h>
+#include <wlr/types/wlr_surface.h>
+
+/**
+ * A bounding volume hierarchy over the input regions of a surface and all of
+ * its subsurfaces, used to answer `wlr_surface_surface_at` queries without
+ * walking the whole surface tree.
+ *
+ * The index is built lazily on the first query and must be invalidated
+ * whenever the geometry, input region or stacking order of a surface in the
+ * tree changes.
+ */
+struct wlr_surface_hit_index;
+
+struct wlr_surface_hit_index *surface_hit_index_create(void);
+void surface_hit_index_destroy(struct wlr_surface_hit_index *index);
+void surface_hit_index_invalidate(struct wlr_surface_hit_index *index);
+/**
+ * Find the topmost surface in the tree of `surface` accepting input at the
+ * given surface-local coordinates, rebuilding the index if necessary. Sets
+ * `ok` to false if the index couldn't be rebuilt or if the tree is too small
+ * to benefit from it, in which case the caller needs to search the tree
+ * itself.
+ */
+struct wlr_surface *surface_hit_index_surface_at(
+	struct wlr_surface_hit_index *index, struct wlr_surface *surface,
+	double sx, double sy, double *sub_x, double *sub_y, bool *ok);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef UTIL_HASH_MAP_H
+#define UTIL_HASH_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct hash_map_entry {
+	uint64_t key; // zero if the slot is empty
+	void *value;
+};
+
+/**
+ * An open-addressing hash map from non-zero 64-bit keys (e.g. pointers or
+ * protocol object IDs) to pointers, using linear probing. Entries are stored
+ * in a single array, so lookups don't chase pointers like a wl_list scan does.
+ *
+ * Pointers to values are not stable across insertions.
+ */
+struct hash_map {
+	struct hash_map_entry *entries;
+	size_t len;
+	size_t cap; // zero or a power of two
+};
+
+void hash_map_init(struct hash_map *map);
+void hash_map_finish(struct hash_map *map);
+/**
+ * Returns the value for `key`, or NULL if there is none.
+ */
+void *hash_map_get(const struct hash_map *map, uint64_t key);
+/**
+ * Inserts or replaces the value for `key`. Returns false on allocation
+ * failure, in which case the map is left unchanged.
+ */
+bool hash_map_set(struct hash_map *map, uint64_t key, void *value);
+/**
+ * Removes `key` from the map and returns its value, or NULL if there was
+ * none.
+ */
+void *hash_map_remove(struct hash_map *map, uint64_t key);
+
+static inline uint64_t hash_map_ptr_key(const void *ptr) {
+	return (uint64_t)(uintptr_t)ptr;
+}
+
+#endif
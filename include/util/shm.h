@@ -1,7 +1,15 @@
 #ifndef UTIL_SHM_H
 #define UTIL_SHM_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 int create_shm_file(void);
 int allocate_shm_file(size_t size);
+/**
+ * Allocate a shared memory file and return a read-write and a read-only file
+ * descriptor for it. The read-only one can safely be shared with clients.
+ */
+bool allocate_shm_file_pair(size_t size, int *rw_fd, int *ro_fd);
 
 #endif
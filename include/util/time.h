@@ -0,0 +1,23 @@
+#ifndef UTIL_TIME_H
+#define UTIL_TIME_H
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Convert a timespec to nanoseconds.
+ */
+uint64_t timespec_to_nsec(const struct timespec *a);
+
+/**
+ * Get the current CLOCK_MONOTONIC time, in nanoseconds.
+ */
+uint64_t get_current_time_nsec(void);
+
+/**
+ * Convert a refresh rate in mHz to a refresh period in nanoseconds. Returns
+ * zero if the refresh rate is unknown.
+ */
+int mhz_to_nsec(int mhz);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef UTIL_TRACE_H
+#define UTIL_TRACE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <wlr/util/trace.h>
+
+extern atomic_bool trace_enabled;
+
+void trace_record(enum wlr_trace_event event, uint64_t arg);
+
+/**
+ * Records a trace event if tracing is enabled.
+ */
+static inline void trace_point(enum wlr_trace_event event, uint64_t arg) {
+	if (__builtin_expect(atomic_load_explicit(&trace_enabled,
+			memory_order_relaxed), 0)) {
+		trace_record(event, arg);
+	}
+}
+
+#endif
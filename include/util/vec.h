@@ -0,0 +1,57 @@
+#ifndef UTIL_VEC_H
+#define UTIL_VEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * A typed growable array. Declare one with e.g. `VEC(struct wlr_box) boxes;`
+ * and zero-initialize it. Elements are stored contiguously, pointers to them
+ * are invalidated when the vector grows.
+ */
+#define VEC(type) \
+	struct { \
+		type *data; \
+		size_t len, cap; \
+	}
+
+/**
+ * Grows `data`, an array of `*cap` elements of `elem_size` bytes, so that it
+ * can hold at least `n` elements, and returns the new array. On allocation
+ * failure, `data` is returned unchanged and `*cap` is left below `n`.
+ */
+void *vec_reserve_bytes(void *data, size_t *cap, size_t n, size_t elem_size);
+
+/**
+ * Ensures the vector can hold at least `n` elements without reallocating.
+ * Returns false on allocation failure, leaving the vector unchanged. `n` is
+ * evaluated twice.
+ */
+#define vec_reserve(vec, n) \
+	((vec)->data = vec_reserve_bytes((vec)->data, &(vec)->cap, (n), \
+		sizeof(*(vec)->data)), (vec)->cap >= (size_t)(n))
+
+/**
+ * Appends a zeroed element and returns a pointer to it, or NULL on
+ * allocation failure.
+ */
+#define vec_add(vec) \
+	(vec_reserve((vec), (vec)->len + 1) ? \
+		memset(&(vec)->data[(vec)->len++], 0, sizeof(*(vec)->data)) : NULL)
+
+#define vec_clear(vec) ((vec)->len = 0)
+
+#define vec_finish(vec) \
+	do { \
+		free((vec)->data); \
+		(vec)->data = NULL; \
+		(vec)->len = (vec)->cap = 0; \
+	} while (0)
+
+#define vec_for_each(pos, vec) \
+	for ((pos) = (vec)->data; \
+		(pos) != NULL && (pos) < (vec)->data + (vec)->len; (pos)++)
+
+#endif
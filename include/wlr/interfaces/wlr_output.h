@@ -45,6 +45,10 @@ void wlr_output_update_enabled(struct wlr_output *output, bool enabled);
 void wlr_output_update_needs_frame(struct wlr_output *output);
 void wlr_output_damage_whole(struct wlr_output *output);
 void wlr_output_send_frame(struct wlr_output *output);
+/**
+ * Emits the present event. If `event` is NULL, the frame being committed is
+ * reported as presented now.
+ */
 void wlr_output_send_present(struct wlr_output *output,
 	struct wlr_output_event_present *event);
 
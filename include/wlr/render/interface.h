@@ -65,9 +65,17 @@ struct wlr_renderer_impl {
 		struct wl_resource *data);
 	struct wlr_texture *(*texture_from_dmabuf)(struct wlr_renderer *renderer,
 		struct wlr_dmabuf_attributes *attribs);
+	bool (*blit_dmabuf)(struct wlr_renderer *renderer,
+		struct wlr_dmabuf_attributes *dst,
+		struct wlr_dmabuf_attributes *src);
+	bool (*read_dmabuf_scaled)(struct wlr_renderer *renderer,
+		struct wlr_dmabuf_attributes *src, const struct wlr_box *src_box,
+		enum wl_shm_format fmt, uint32_t stride, uint32_t width,
+		uint32_t height, void *data);
 	void (*destroy)(struct wlr_renderer *renderer);
 	void (*init_wl_display)(struct wlr_renderer *renderer,
 		struct wl_display *wl_display);
+	int (*create_fence)(struct wlr_renderer *renderer);
 };
 
 void wlr_renderer_init(struct wlr_renderer *renderer,
@@ -82,6 +90,7 @@ struct wlr_texture_impl {
 		const void *data);
 	bool (*to_dmabuf)(struct wlr_texture *texture,
 		struct wlr_dmabuf_attributes *attribs);
+	bool (*samples_dmabuf)(struct wlr_texture *texture);
 	void (*destroy)(struct wlr_texture *texture);
 };
 
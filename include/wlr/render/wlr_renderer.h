@@ -22,9 +22,25 @@ enum wlr_renderer_read_pixels_flags {
 struct wlr_renderer_impl;
 struct wlr_drm_format_set;
 
+/**
+ * Statistics about the damage uploads done by `wlr_buffer_apply_damage`.
+ */
+struct wlr_buffer_upload_stats {
+	size_t uploads; // number of damage uploads
+	size_t damage_rects; // number of damage rectangles
+	size_t writes; // number of texture writes
+	size_t bytes; // number of bytes written
+
+	// number of uploads which wrote each damage rectangle separately, merged
+	// some of them, or wrote the damage extents at once
+	size_t per_rect, merged, extents;
+};
+
 struct wlr_renderer {
 	const struct wlr_renderer_impl *impl;
 
+	struct wlr_buffer_upload_stats upload_stats;
+
 	struct {
 		struct wl_signal destroy;
 	} events;
@@ -102,6 +118,22 @@ const struct wlr_drm_format_set *wlr_renderer_get_dmabuf_formats(
 bool wlr_renderer_read_pixels(struct wlr_renderer *r, enum wl_shm_format fmt,
 	uint32_t *flags, uint32_t stride, uint32_t width, uint32_t height,
 	uint32_t src_x, uint32_t src_y, uint32_t dst_x, uint32_t dst_y, void *data);
+/**
+ * Copies the contents of the `src` DMA-BUF into the `dst` DMA-BUF on the GPU.
+ * Returns false if the renderer doesn't support this or the copy failed.
+ */
+bool wlr_renderer_blit_dmabuf(struct wlr_renderer *r,
+	struct wlr_dmabuf_attributes *dst, struct wlr_dmabuf_attributes *src);
+/**
+ * Reads the `src_box` region of the `src` DMA-BUF into `data`, scaled down to
+ * `width`x`height` on the GPU. `stride` is in bytes. The result is upright.
+ * Returns false if the renderer doesn't support this, or if the requested size
+ * is larger than `src_box`.
+ */
+bool wlr_renderer_read_dmabuf_scaled(struct wlr_renderer *r,
+	struct wlr_dmabuf_attributes *src, const struct wlr_box *src_box,
+	enum wl_shm_format fmt, uint32_t stride, uint32_t width, uint32_t height,
+	void *data);
 /**
  * Checks if a format is supported.
  */
@@ -109,6 +141,13 @@ bool wlr_renderer_format_supported(struct wlr_renderer *r,
 	enum wl_shm_format fmt);
 void wlr_renderer_init_wl_display(struct wlr_renderer *r,
 	struct wl_display *wl_display);
+/**
+ * Creates a sync_file fence which is signalled once all rendering commands
+ * submitted so far have completed, and returns its FD. Returns -1 if the
+ * renderer can't export fences, in which case the rendering commands have
+ * already completed when this function returns.
+ */
+int wlr_renderer_create_fence(struct wlr_renderer *r);
 /**
  * Destroys this wlr_renderer. Textures must be destroyed separately.
  */
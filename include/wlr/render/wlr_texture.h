@@ -65,6 +65,14 @@ bool wlr_texture_write_pixels(struct wlr_texture *texture,
 bool wlr_texture_to_dmabuf(struct wlr_texture *texture,
 	struct wlr_dmabuf_attributes *attribs);
 
+/**
+ * Returns true if the texture samples the DMA-BUF it has been imported from
+ * directly, instead of a copy made at import time. The contents of such a
+ * texture always match the buffer's, so it can be kept and re-used when the
+ * same buffer is committed again.
+ */
+bool wlr_texture_samples_dmabuf(struct wlr_texture *texture);
+
 /**
  * Destroys this wlr_texture.
  */
@@ -12,6 +12,7 @@
 #include <pixman.h>
 #include <wayland-server-core.h>
 #include <wlr/render/dmabuf.h>
+#include <wlr/render/wlr_renderer.h>
 
 /**
  * A client buffer.
@@ -21,6 +22,10 @@ struct wlr_buffer {
 	 * The buffer resource, if any. Will be NULL if the client destroys it.
 	 */
 	struct wl_resource *resource;
+	/**
+	 * The renderer the buffer has been uploaded with.
+	 */
+	struct wlr_renderer *renderer;
 	/**
 	 * The buffer's texture, if any. A buffer will not have a texture if the
 	 * client destroys the buffer before it has been released.
@@ -30,9 +35,11 @@ struct wlr_buffer {
 	size_t n_refs;
 
 	struct wl_listener resource_destroy;
-};
 
-struct wlr_renderer;
+	struct {
+		struct wl_signal destroy;
+	} events;
+};
 
 /**
  * Check if a resource is a wl_buffer resource.
@@ -68,6 +75,12 @@ void wlr_buffer_unref(struct wlr_buffer *buffer);
  */
 struct wlr_buffer *wlr_buffer_apply_damage(struct wlr_buffer *buffer,
 	struct wl_resource *resource, pixman_region32_t *damage);
+/**
+ * Get statistics about the damage uploads done so far with buffers created
+ * from `renderer`.
+ */
+void wlr_buffer_get_upload_stats(struct wlr_renderer *renderer,
+	struct wlr_buffer_upload_stats *stats);
 /**
  * Reads the DMA-BUF attributes of the buffer. If this buffer isn't a DMA-BUF,
  * returns false.
@@ -0,0 +1,105 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_INPUT_LATENCY_H
+#define WLR_TYPES_WLR_INPUT_LATENCY_H
+
+#include <stdint.h>
+#include <wayland-server-core.h>
+#include <wlr/types/wlr_output.h>
+
+/**
+ * Number of histogram buckets. Bucket `i` counts samples in
+ * [2^i, 2^(i + 1)) microseconds, except for the first one which also counts
+ * samples under a microsecond and the last one which counts everything above.
+ */
+#define WLR_INPUT_LATENCY_BUCKETS 24
+/**
+ * Number of committed frames per output whose presentation can be waited for
+ * at once. If more are in flight, the oldest ones are dropped.
+ */
+#define WLR_INPUT_LATENCY_MAX_FRAMES 4
+
+struct wlr_input_latency_histogram {
+	uint64_t buckets[WLR_INPUT_LATENCY_BUCKETS];
+	uint64_t count;
+	uint64_t sum_nsec, max_nsec;
+};
+
+/**
+ * Measures how long input events take to reach clients and to show up on
+ * screen, using the CLOCK_MONOTONIC `time_nsec` timestamp backends set on
+ * pointer, keyboard and touch events.
+ *
+ * The compositor reports when it has dispatched an event to a client with
+ * `wlr_input_latency_record_dispatch`, and which output the effect of an
+ * event has been drawn on with `wlr_input_latency_record_damage`. The latter
+ * is latched into the next frame committed on that output and accounted for
+ * once that frame is presented.
+ */
+struct wlr_input_latency {
+	struct wlr_input_latency_histogram dispatch; // event to client
+	struct wlr_input_latency_histogram present; // event to light
+
+	struct wl_list outputs; // wlr_input_latency_output.link
+
+	struct {
+		struct wl_signal destroy;
+	} events;
+
+	void *data;
+};
+
+struct wlr_input_latency_frame {
+	uint32_t commit_seq; // wlr_output.commit_seq
+	uint64_t event_nsec; // oldest event drawn in the frame
+};
+
+struct wlr_input_latency_output {
+	struct wlr_input_latency *latency;
+	struct wlr_output *output;
+	struct wl_list link; // wlr_input_latency.outputs
+
+	// Timestamp of the oldest event drawn since the last commit, zero if none
+	uint64_t pending_nsec;
+	// Frames waiting to be presented, oldest first
+	struct wlr_input_latency_frame frames[WLR_INPUT_LATENCY_MAX_FRAMES];
+	size_t frames_len;
+
+	struct wl_listener output_precommit;
+	struct wl_listener output_present;
+	struct wl_listener output_destroy;
+};
+
+struct wlr_input_latency *wlr_input_latency_create(void);
+void wlr_input_latency_destroy(struct wlr_input_latency *latency);
+/**
+ * Records that the input event timestamped `event_nsec` has been sent to a
+ * client. Events without a timestamp are ignored.
+ */
+void wlr_input_latency_record_dispatch(struct wlr_input_latency *latency,
+	uint64_t event_nsec);
+/**
+ * Records that the effect of the input event timestamped `event_nsec` has
+ * been drawn on `output`. Events without a timestamp are ignored.
+ */
+void wlr_input_latency_record_damage(struct wlr_input_latency *latency,
+	struct wlr_output *output, uint64_t event_nsec);
+/**
+ * Resets both histograms.
+ */
+void wlr_input_latency_reset(struct wlr_input_latency *latency);
+/**
+ * Returns an upper bound of the given percentile (between 0 and 100) of the
+ * samples in the histogram, in nanoseconds. Returns zero if the histogram is
+ * empty.
+ */
+uint64_t wlr_input_latency_histogram_percentile(
+	const struct wlr_input_latency_histogram *histogram, double percentile);
+
+#endif
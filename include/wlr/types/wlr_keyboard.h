@@ -52,6 +52,7 @@ struct wlr_keyboard {
 
 	char *keymap_string;
 	size_t keymap_size;
+	int keymap_fd; // read-only, shared with all clients
 	struct xkb_keymap *keymap;
 	struct xkb_state *xkb_state;
 	xkb_led_index_t led_indexes[WLR_LED_COUNT];
@@ -96,6 +97,7 @@ enum wlr_key_state {
 
 struct wlr_event_keyboard_key {
 	uint32_t time_msec;
+	uint64_t time_nsec; // CLOCK_MONOTONIC, zero if unknown
 	uint32_t keycode;
 	bool update_state; // if backend doesn't update modifiers on its own
 	enum wlr_key_state state;
@@ -14,11 +14,19 @@
 #include <wlr/render/dmabuf.h>
 
 struct wlr_dmabuf_v1_buffer {
-	struct wlr_renderer *renderer;
+	struct wlr_renderer *renderer; // NULL once linux-dmabuf is destroyed
+	struct wl_list link; // wlr_linux_dmabuf_v1::buffers
 	struct wl_resource *buffer_resource;
 	struct wl_resource *params_resource;
 	struct wlr_dmabuf_attributes attributes;
 	bool has_modifier;
+
+	// Texture imported from the DMA-BUF, kept until the wl_buffer or the
+	// linux-dmabuf global is destroyed so that committing the same buffer
+	// again doesn't re-import it. Only textures sampling the DMA-BUF directly
+	// are kept. It is lent to at most one wlr_buffer at a time.
+	struct wlr_texture *texture;
+	bool texture_lent;
 };
 
 /**
@@ -46,6 +54,7 @@ struct wlr_linux_dmabuf_v1 {
 	struct wl_global *global;
 	struct wlr_renderer *renderer;
 	struct wl_list resources;
+	struct wl_list buffers; // wlr_dmabuf_v1_buffer::link
 
 	struct {
 		struct wl_signal destroy;
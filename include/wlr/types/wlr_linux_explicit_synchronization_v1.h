@@ -0,0 +1,80 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_LINUX_EXPLICIT_SYNCHRONIZATION_H
+#define WLR_TYPES_WLR_LINUX_EXPLICIT_SYNCHRONIZATION_H
+
+#include <wayland-server-core.h>
+
+struct wlr_linux_explicit_synchronization_v1 {
+	struct wl_global *global;
+	struct wl_list resources; // wl_resource_get_link
+
+	struct {
+		struct wl_signal destroy;
+	} events;
+
+	struct wl_listener display_destroy;
+};
+
+/**
+ * A surface's explicit synchronization state. The acquire fence and buffer
+ * release are double-buffered: they are moved to the surface's pending state
+ * when the client commits.
+ */
+struct wlr_linux_surface_synchronization_v1 {
+	struct wl_resource *resource;
+	struct wlr_surface *surface;
+
+	int pending_fence_fd; // -1 if unset
+	struct wlr_linux_buffer_release_v1 *pending_buffer_release;
+
+	struct wl_listener surface_destroy;
+	struct wl_listener surface_client_commit;
+};
+
+/**
+ * A request to be notified when the compositor is done reading a committed
+ * buffer. The object is owned by the surface state it's committed with, and
+ * then by the wlr_buffer created from that state until it's destroyed.
+ */
+struct wlr_linux_buffer_release_v1 {
+	struct wl_resource *resource; // NULL if the client has gone away
+	struct wlr_renderer *renderer;
+	struct wlr_buffer *buffer; // NULL until attached to a buffer
+
+	struct wl_listener buffer_destroy;
+};
+
+/**
+ * Creates the zwp_linux_explicit_synchronization_v1 global. Clients can then
+ * attach acquire fences to DMA-BUF buffers, whose commits are applied once
+ * the fences are signalled, and ask for release fences signalled once the
+ * renderer is done reading them.
+ */
+struct wlr_linux_explicit_synchronization_v1 *
+	wlr_linux_explicit_synchronization_v1_create(struct wl_display *display);
+void wlr_linux_explicit_synchronization_v1_destroy(
+	struct wlr_linux_explicit_synchronization_v1 *explicit_sync);
+
+/**
+ * Sends the release event once `buffer` is destroyed, along with a fence
+ * signalled when the rendering commands submitted so far have completed.
+ * Destroys the buffer release if `buffer` is NULL.
+ */
+void wlr_linux_buffer_release_v1_attach(
+	struct wlr_linux_buffer_release_v1 *buffer_release,
+	struct wlr_buffer *buffer);
+/**
+ * Tells the client its buffer can be re-used right away and destroys the
+ * buffer release. Used when a committed buffer is never read.
+ */
+void wlr_linux_buffer_release_v1_destroy(
+	struct wlr_linux_buffer_release_v1 *buffer_release);
+
+#endif
@@ -181,6 +181,9 @@ struct wlr_output_event_present {
 	// refresh may occur. Zero if unknown.
 	int refresh; // nsec
 	uint32_t flags; // enum wlr_output_present_flag
+	// wlr_output.commit_seq of the commit which has been presented. Earlier
+	// commits not presented before have been superseded by it.
+	uint32_t commit_seq;
 };
 
 struct wlr_surface;
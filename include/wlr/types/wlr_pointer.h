@@ -38,6 +38,7 @@ struct wlr_pointer {
 struct wlr_event_pointer_motion {
 	struct wlr_input_device *device;
 	uint32_t time_msec;
+	uint64_t time_nsec; // CLOCK_MONOTONIC, zero if unknown
 	double delta_x, delta_y;
 	double unaccel_dx, unaccel_dy;
 };
@@ -45,6 +46,7 @@ struct wlr_event_pointer_motion {
 struct wlr_event_pointer_motion_absolute {
 	struct wlr_input_device *device;
 	uint32_t time_msec;
+	uint64_t time_nsec; // CLOCK_MONOTONIC, zero if unknown
 	// From 0..1
 	double x, y;
 };
@@ -52,6 +54,7 @@ struct wlr_event_pointer_motion_absolute {
 struct wlr_event_pointer_button {
 	struct wlr_input_device *device;
 	uint32_t time_msec;
+	uint64_t time_nsec; // CLOCK_MONOTONIC, zero if unknown
 	uint32_t button;
 	enum wlr_button_state state;
 };
@@ -71,6 +74,7 @@ enum wlr_axis_orientation {
 struct wlr_event_pointer_axis {
 	struct wlr_input_device *device;
 	uint32_t time_msec;
+	uint64_t time_nsec; // CLOCK_MONOTONIC, zero if unknown
 	enum wlr_axis_source source;
 	enum wlr_axis_orientation orientation;
 	double delta;
@@ -80,12 +84,14 @@ struct wlr_event_pointer_axis {
 struct wlr_event_pointer_swipe_begin {
 	struct wlr_input_device *device;
 	uint32_t time_msec;
+	uint64_t time_nsec; // CLOCK_MONOTONIC, zero if unknown
 	uint32_t fingers;
 };
 
 struct wlr_event_pointer_swipe_update {
 	struct wlr_input_device *device;
 	uint32_t time_msec;
+	uint64_t time_nsec; // CLOCK_MONOTONIC, zero if unknown
 	uint32_t fingers;
 	// Relative coordinates of the logical center of the gesture
 	// compared to the previous event.
@@ -95,18 +101,21 @@ struct wlr_event_pointer_swipe_update {
 struct wlr_event_pointer_swipe_end {
 	struct wlr_input_device *device;
 	uint32_t time_msec;
+	uint64_t time_nsec; // CLOCK_MONOTONIC, zero if unknown
 	bool cancelled;
 };
 
 struct wlr_event_pointer_pinch_begin {
 	struct wlr_input_device *device;
 	uint32_t time_msec;
+	uint64_t time_nsec; // CLOCK_MONOTONIC, zero if unknown
 	uint32_t fingers;
 };
 
 struct wlr_event_pointer_pinch_update {
 	struct wlr_input_device *device;
 	uint32_t time_msec;
+	uint64_t time_nsec; // CLOCK_MONOTONIC, zero if unknown
 	uint32_t fingers;
 	// Relative coordinates of the logical center of the gesture
 	// compared to the previous event.
@@ -120,6 +129,7 @@ struct wlr_event_pointer_pinch_update {
 struct wlr_event_pointer_pinch_end {
 	struct wlr_input_device *device;
 	uint32_t time_msec;
+	uint64_t time_nsec; // CLOCK_MONOTONIC, zero if unknown
 	bool cancelled;
 };
 
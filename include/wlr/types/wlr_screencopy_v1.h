@@ -15,8 +15,17 @@
 
 struct wlr_screencopy_manager_v1 {
 	struct wl_global *global;
+	// wlroots-private extension for scaled-down captures
+	struct wl_global *scaled_global;
 	struct wl_list resources; // wl_resource
 	struct wl_list frames; // wlr_screencopy_frame_v1::link
+	// Per-output staging buffers shared by all frames copying the same commit
+	struct wl_list readbacks; // screencopy_readback::link
+
+	// Maximum number of damage rectangles sent for a frame. Damage made of
+	// more rectangles is reported as its bounding box. Frames are always
+	// copied in full. Zero means no limit.
+	int max_damage_rects;
 
 	struct wl_listener display_destroy;
 
@@ -39,18 +48,25 @@ struct wlr_screencopy_frame_v1 {
 	struct wl_list link;
 
 	enum wl_shm_format format;
-	struct wlr_box box;
+	uint32_t fourcc; // for DMA-BUF buffers, DRM_FORMAT_INVALID if unsupported
+	struct wlr_box box; // in output buffer coordinates
+	// Size of the client's buffer, smaller than the box for scaled captures
+	int width, height;
+	bool scale_on_gpu; // for scaled captures, once a buffer has been attached
 	int stride;
 
 	bool overlay_cursor, cursor_locked;
 
 	bool with_damage;
 
+	// Only one of these is set, once the client has sent a copy request
 	struct wl_shm_buffer *buffer;
+	struct wlr_dmabuf_v1_buffer *dma_buffer;
 	struct wl_listener buffer_destroy;
 
 	struct wlr_output *output;
 	struct wl_listener output_precommit;
+	struct wl_listener output_commit;
 	struct wl_listener output_destroy;
 	struct wl_listener output_enable;
 
@@ -165,6 +165,14 @@ struct wlr_seat_pointer_state {
 	uint32_t grab_serial;
 	uint32_t grab_time;
 
+	// see wlr_seat_pointer_set_motion_coalescing
+	struct {
+		uint32_t max_delay_ms; // 0 if disabled
+		bool motion_pending, frame_pending;
+		uint32_t time_msec;
+		struct wl_event_source *timer;
+	} coalesce;
+
 	struct wl_listener surface_destroy;
 
 	struct {
@@ -206,11 +214,13 @@ struct wlr_seat_touch_state {
 };
 
 struct wlr_primary_selection_source;
+struct wlr_seat_state;
 
 struct wlr_seat {
 	struct wl_global *global;
 	struct wl_display *display;
 	struct wl_list clients;
+	struct wlr_seat_state *state;
 
 	char *name;
 	uint32_t capabilities;
@@ -383,6 +393,26 @@ void wlr_seat_pointer_send_axis(struct wlr_seat *wlr_seat, uint32_t time_msec,
  */
 void wlr_seat_pointer_send_frame(struct wlr_seat *wlr_seat);
 
+/**
+ * Enable coalescing of pointer motion events. When enabled, motion events and
+ * the frame events following them are buffered, and only the latest position
+ * is sent to the focused client. Buffered motion is sent when
+ * `wlr_seat_pointer_flush_motion()` is called (e.g. on output frame), before
+ * any other pointer event, and at the latest `max_delay_ms` milliseconds after
+ * the first buffered motion event. A `max_delay_ms` of zero disables
+ * coalescing, which is the default.
+ *
+ * Relative pointer events are not affected.
+ */
+void wlr_seat_pointer_set_motion_coalescing(struct wlr_seat *wlr_seat,
+		uint32_t max_delay_ms);
+
+/**
+ * Send buffered motion events to the surface with pointer focus, if any. See
+ * `wlr_seat_pointer_set_motion_coalescing()`.
+ */
+void wlr_seat_pointer_flush_motion(struct wlr_seat *wlr_seat);
+
 /**
  * Start a grab of the pointer of this seat. The grabber is responsible for
  * handling all pointer events until the grab ends.
@@ -41,6 +41,11 @@ struct wlr_surface_state {
 	int width, height; // in surface-local coordinates
 	int buffer_width, buffer_height;
 
+	// explicit synchronization of the committed buffer, see
+	// wlr_linux_explicit_synchronization_v1
+	int acquire_fence_fd; // -1 if unset
+	struct wlr_linux_buffer_release_v1 *buffer_release; // NULL if unset
+
 	struct wl_listener buffer_destroy;
 };
 
@@ -60,6 +65,16 @@ struct wlr_surface {
 	 * or something went wrong with uploading the buffer.
 	 */
 	struct wlr_buffer *buffer;
+	/**
+	 * A committed wl_shm buffer whose upload into the texture of `buffer` is
+	 * deferred until the texture is needed, see `wlr_surface_get_texture`.
+	 * Until then, `buffer` keeps the previous contents.
+	 */
+	struct {
+		struct wl_resource *resource; // NULL if nothing is pending
+		pixman_region32_t damage; // buffer-local
+		struct wl_listener resource_destroy;
+	} upload;
 	/**
 	 * The buffer position, in surface-local units.
 	 */
@@ -99,6 +114,9 @@ struct wlr_surface {
 	void *role_data; // role-specific data
 
 	struct {
+		// raised when the client commits, before the pending state is
+		// applied or cached
+		struct wl_signal client_commit;
 		struct wl_signal commit;
 		struct wl_signal new_subsurface;
 		struct wl_signal destroy;
@@ -111,6 +129,24 @@ struct wlr_surface {
 
 	struct wl_listener renderer_destroy;
 
+	// private state
+
+	// see wlr_surface_enable_hit_index, NULL if disabled
+	struct wlr_surface_hit_index *hit_index;
+
+	// State committed by the client, held back until its acquire fence is
+	// signalled
+	struct wlr_surface_state fenced;
+	struct wl_event_source *fence_source; // NULL if no commit is held back
+
+	// see wlr_surface_set_output_visible
+	struct {
+		struct wl_list visible_outputs; // wlr_surface_visible_output::link
+		int occluded_interval; // ms, 0 if occluded surfaces aren't throttled
+		int64_t last_done_msec;
+		struct wl_event_source *timer;
+	} frame_pacing;
+
 	void *data;
 };
 
@@ -127,6 +163,9 @@ struct wlr_subsurface {
 
 	struct wlr_surface_state cached;
 	bool has_cache;
+	// number of subsurfaces with a cached state in this subsurface's tree,
+	// including this one
+	int subtree_cache_count;
 
 	bool synchronized;
 	bool reordered;
@@ -180,6 +219,9 @@ bool wlr_surface_has_buffer(struct wlr_surface *surface);
  * Get the texture of the buffer currently attached to this surface. Returns
  * NULL if no buffer is currently attached or if something went wrong with
  * uploading the buffer.
+ *
+ * Uploads of wl_shm buffers updating an existing texture are deferred until
+ * this function is called, so it should be called right before rendering.
  */
 struct wlr_texture *wlr_surface_get_texture(struct wlr_surface *surface);
 
@@ -211,15 +253,51 @@ bool wlr_surface_point_accepts_input(struct wlr_surface *surface,
 struct wlr_surface *wlr_surface_surface_at(struct wlr_surface *surface,
 		double sx, double sy, double *sub_x, double *sub_y);
 
+/**
+ * Enable or disable the spatial index used by `wlr_surface_surface_at` for
+ * this surface's tree. Disabled by default, in which case the tree is walked
+ * on each query.
+ *
+ * The index is built on the first query, and kept until a surface in the tree
+ * is resized, moved, restacked or changes its input region. Queries then take
+ * logarithmic time in the tree size. It's only worth enabling for large
+ * surface trees which are queried much more often than they change; the index
+ * isn't used for trees with only a few surfaces.
+ */
+void wlr_surface_enable_hit_index(struct wlr_surface *surface, bool enabled);
+
 void wlr_surface_send_enter(struct wlr_surface *surface,
 		struct wlr_output *output);
 
 void wlr_surface_send_leave(struct wlr_surface *surface,
 		struct wlr_output *output);
 
+/**
+ * Send the frame done event to the surface's pending frame callbacks. If the
+ * surface is occluded and throttled (see
+ * `wlr_surface_set_occluded_frame_rate`), calls made faster than the throttled
+ * rate are deferred.
+ */
 void wlr_surface_send_frame_done(struct wlr_surface *surface,
 		const struct timespec *when);
 
+/**
+ * Mark the surface as visible or hidden on the output. A surface which isn't
+ * visible on any output is considered occluded.
+ */
+void wlr_surface_set_output_visible(struct wlr_surface *surface,
+		struct wlr_output *output, bool visible);
+
+/**
+ * Limit frame done events sent to the surface while it's occluded to `rate`
+ * per second. Frame callbacks of an occluded surface are completed at that
+ * rate even if the compositor stops calling `wlr_surface_send_frame_done`,
+ * so that clients can make progress without rendering at full rate. A rate of
+ * zero disables throttling, which is the default.
+ */
+void wlr_surface_set_occluded_frame_rate(struct wlr_surface *surface,
+		int rate);
+
 struct wlr_box;
 /**
  * Get the bounding box that contains the surface and all subsurfaces in
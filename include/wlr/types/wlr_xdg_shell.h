@@ -242,6 +242,51 @@ struct wlr_xdg_toplevel_show_window_menu_event {
 	uint32_t x, y;
 };
 
+/**
+ * A set of toplevel resizes applied together. The compositor adds the new
+ * sizes, commits the transaction, and waits for the `ready` event before
+ * laying out the toplevels with their new sizes, so that the clients'
+ * resized buffers all show up at once.
+ */
+struct wlr_xdg_configure_transaction {
+	struct wl_event_loop *event_loop;
+	struct wl_list entries; // wlr_xdg_configure_transaction_entry::link
+	size_t pending; // number of entries not ready yet
+	bool committed;
+	bool timed_out;
+
+	struct wl_event_source *timer;
+
+	struct {
+		/**
+		 * Emitted once all toplevels have acked their configure and committed
+		 * a new buffer, or once the timeout has expired. The transaction is
+		 * destroyed right after this event.
+		 */
+		struct wl_signal ready;
+		struct wl_signal destroy;
+	} events;
+
+	void *data;
+};
+
+struct wlr_xdg_configure_transaction_entry {
+	struct wlr_xdg_configure_transaction *transaction;
+	struct wl_list link; // wlr_xdg_configure_transaction::entries
+	struct wlr_xdg_surface *surface; // NULL if the surface has been destroyed
+
+	uint32_t width, height;
+	uint32_t serial; // 0 if the toplevel already had the requested size
+	bool acked, ready;
+
+	struct wl_listener surface_destroy;
+	struct wl_listener surface_unmap;
+	struct wl_listener surface_ack_configure;
+	struct wl_listener surface_commit;
+
+	void *data;
+};
+
 struct wlr_xdg_shell *wlr_xdg_shell_create(struct wl_display *display);
 void wlr_xdg_shell_destroy(struct wlr_xdg_shell *xdg_shell);
 
@@ -397,4 +442,35 @@ uint32_t wlr_xdg_surface_schedule_configure(struct wlr_xdg_surface *surface);
 void wlr_xdg_surface_for_each_popup(struct wlr_xdg_surface *surface,
 	wlr_surface_iterator_func_t iterator, void *user_data);
 
+/**
+ * Create a configure transaction. Toplevel sizes are added with
+ * `wlr_xdg_configure_transaction_add_size` and only sent to the clients when
+ * the transaction is committed.
+ */
+struct wlr_xdg_configure_transaction *wlr_xdg_configure_transaction_create(
+	struct wl_display *display);
+/**
+ * Add a toplevel to the transaction. If the toplevel has already been added,
+ * its requested size is updated. Returns the new entry, or NULL on error.
+ * Must not be called after the transaction has been committed.
+ */
+struct wlr_xdg_configure_transaction_entry *
+	wlr_xdg_configure_transaction_add_size(
+	struct wlr_xdg_configure_transaction *transaction,
+	struct wlr_xdg_surface *surface, uint32_t width, uint32_t height);
+/**
+ * Send the configures of all toplevels in the transaction at once, and start
+ * waiting for the clients. The `ready` event is emitted after at most
+ * `timeout_ms` milliseconds; a timeout of zero waits indefinitely. If no
+ * toplevel needs to be reconfigured, `ready` is emitted right away.
+ */
+void wlr_xdg_configure_transaction_commit(
+	struct wlr_xdg_configure_transaction *transaction, uint32_t timeout_ms);
+/**
+ * Destroy the transaction without emitting the `ready` event. Configures which
+ * have already been sent are not reverted.
+ */
+void wlr_xdg_configure_transaction_destroy(
+	struct wlr_xdg_configure_transaction *transaction);
+
 #endif
@@ -0,0 +1,70 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_UTIL_TRACE_H
+#define WLR_UTIL_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <wayland-server-core.h>
+
+/**
+ * Events recorded by the tracepoints compiled into wlroots. Each one carries
+ * a CLOCK_MONOTONIC timestamp and a 64-bit argument, described next to it.
+ */
+enum wlr_trace_event {
+	WLR_TRACE_SURFACE_COMMIT, // surface resource ID
+	WLR_TRACE_OUTPUT_COMMIT, // output commit sequence number
+	WLR_TRACE_RENDER_BEGIN, // render width << 32 | height
+	WLR_TRACE_RENDER_END, // unused
+	WLR_TRACE_PAGE_FLIP, // DRM CRTC ID
+	WLR_TRACE_POINTER_MOTION, // event time in milliseconds
+	WLR_TRACE_POINTER_BUTTON, // button code
+	WLR_TRACE_POINTER_AXIS, // event time in milliseconds
+	WLR_TRACE_KEYBOARD_KEY, // key code
+	WLR_TRACE_TOUCH_DOWN, // touch ID
+	WLR_TRACE_TOUCH_UP, // touch ID
+	WLR_TRACE_TOUCH_MOTION, // touch ID
+	WLR_TRACE_XWM_EVENT, // X11 event response type
+	WLR_TRACE_EVENT_LAST,
+};
+
+/**
+ * Starts recording trace events into a ring buffer holding the last
+ * `capacity` events, rounded up to a power of two. Tracing is disabled by
+ * default, in which case tracepoints only cost a branch.
+ *
+ * Recording an event doesn't take any lock, so tracepoints can be hit from
+ * any thread. However this function and wlr_trace_finish must not be called
+ * while other threads may hit tracepoints, since they replace the ring
+ * buffer.
+ *
+ * Returns false if `capacity` is too large.
+ */
+bool wlr_trace_init(size_t capacity);
+/**
+ * Stops recording trace events and frees the ring buffer. See wlr_trace_init
+ * for threading constraints.
+ */
+void wlr_trace_finish(void);
+bool wlr_trace_is_enabled(void);
+/**
+ * Writes the events currently in the ring buffer to `path`, in the Chrome
+ * trace event JSON format. The file can be opened with chrome://tracing or
+ * Perfetto.
+ */
+bool wlr_trace_dump(const char *path);
+/**
+ * Dumps the trace to `path` whenever the process receives `signal_number`.
+ * The signal is handled by the event loop, so the dump happens outside of
+ * signal handler context. Remove the returned event source to stop.
+ */
+struct wl_event_source *wlr_trace_dump_on_signal(struct wl_event_loop *loop,
+	int signal_number, const char *path);
+
+#endif
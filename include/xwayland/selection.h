@@ -4,6 +4,9 @@
 #include <xcb/xfixes.h>
 
 #define INCR_CHUNK_SIZE (64 * 1024)
+// Upper bound for INCR chunks, the actual size depends on the X server's
+// maximum request length
+#define INCR_CHUNK_SIZE_MAX (1024 * 1024)
 
 #define XDND_VERSION 5
 
@@ -11,6 +11,7 @@
 #if WLR_HAS_XCB_ERRORS
 #include <xcb/xcb_errors.h>
 #endif
+#include "util/hash_map.h"
 #include "xwayland/selection.h"
 
 /* This is in xcb/xcb_event.h, but pulling xcb-util just for a constant
@@ -18,6 +19,13 @@
  */
 #define XCB_EVENT_RESPONSE_TYPE_MASK (0x7f)
 
+/* Maximum number of X11 events and time in nanoseconds spent handling them per
+ * event loop iteration. Remaining events are handled on the next iteration, so
+ * that a flooding X11 client cannot starve Wayland clients.
+ */
+#define XWM_EVENT_BUDGET 128
+#define XWM_EVENT_TIME_BUDGET_NSEC (4 * 1000 * 1000)
+
 enum atom_name {
 	WL_SURFACE_ID,
 	WM_DELETE_WINDOW,
@@ -95,6 +103,7 @@ enum net_wm_state_action {
 struct wlr_xwm {
 	struct wlr_xwayland *xwayland;
 	struct wl_event_source *event_source;
+	bool event_throttled;
 	struct wlr_seat *seat;
 	uint32_t ping_timeout;
 
@@ -108,6 +117,7 @@ struct wlr_xwm {
 	xcb_cursor_t cursor;
 
 	xcb_window_t selection_window;
+	size_t incr_chunk_size;
 	struct wlr_xwm_selection clipboard_selection;
 	struct wlr_xwm_selection primary_selection;
 
@@ -117,6 +127,7 @@ struct wlr_xwm {
 	struct wlr_xwayland_surface *focus_surface;
 
 	struct wl_list surfaces; // wlr_xwayland_surface::link
+	struct hash_map surfaces_by_id; // xcb_window_t -> wlr_xwayland_surface
 	struct wl_list unpaired_surfaces; // wlr_xwayland_surface::unpaired_link
 
 	struct wlr_drag *drag;
@@ -127,6 +138,10 @@ struct wlr_xwm {
 	xcb_errors_context_t *errors_context;
 #endif
 
+	// Number of events handled, indexed by response type
+	uint64_t event_count[XCB_EVENT_RESPONSE_TYPE_MASK + 1];
+	uint64_t throttle_count;
+
 	struct wl_listener compositor_new_surface;
 	struct wl_listener compositor_destroy;
 	struct wl_listener seat_set_selection;
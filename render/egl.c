@@ -198,6 +198,10 @@ bool wlr_egl_init(struct wlr_egl *egl, EGLenum platform, void *remote_display,
 		check_egl_ext(egl->exts_str, "EGL_MESA_image_dma_buf_export") &&
 		eglExportDMABUFImageQueryMESA && eglExportDMABUFImageMESA;
 
+	egl->exts.native_fence_sync_android =
+		check_egl_ext(egl->exts_str, "EGL_ANDROID_native_fence_sync") &&
+		eglCreateSyncKHR && eglDestroySyncKHR && eglDupNativeFenceFDANDROID;
+
 	init_dmabuf_formats(egl);
 
 	egl->exts.bind_wayland_display_wl =
@@ -361,6 +361,250 @@ static void gles2_init_wl_display(struct wlr_renderer *wlr_renderer,
 	}
 }
 
+static bool gles2_blit_dmabuf(struct wlr_renderer *wlr_renderer,
+		struct wlr_dmabuf_attributes *dst_attr,
+		struct wlr_dmabuf_attributes *src_attr) {
+	struct wlr_gles2_renderer *renderer = gles2_get_renderer(wlr_renderer);
+
+	if (!renderer->egl->exts.image_base_khr ||
+			!glEGLImageTargetRenderbufferStorageOES) {
+		return false;
+	}
+
+	// Render into our own framebuffer, the current surface isn't needed
+	if (!wlr_egl_make_current(renderer->egl, EGL_NO_SURFACE, NULL)) {
+		return false;
+	}
+
+	struct wlr_texture *src_tex =
+		wlr_gles2_texture_from_dmabuf(renderer->egl, src_attr);
+	if (src_tex == NULL) {
+		return false;
+	}
+
+	EGLImageKHR image =
+		wlr_egl_create_image_from_dmabuf(renderer->egl, dst_attr);
+	if (image == EGL_NO_IMAGE_KHR) {
+		wlr_texture_destroy(src_tex);
+		return false;
+	}
+
+	PUSH_GLES2_DEBUG;
+
+	bool ok = false;
+	GLuint rbo = 0;
+	glGenRenderbuffers(1, &rbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+	glEGLImageTargetRenderbufferStorageOES(GL_RENDERBUFFER, image);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLuint fbo = 0;
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		GL_RENDERBUFFER, rbo);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		wlr_log(WLR_ERROR, "Failed to create framebuffer for DMA-BUF blit");
+		goto out;
+	}
+
+	// Both buffers are read and written through GL in the same orientation,
+	// so map the texture to the whole viewport without flipping it
+	const float matrix[9] = {
+		2.0f, 0.0f, -1.0f,
+		0.0f, 2.0f, -1.0f,
+		0.0f, 0.0f, 1.0f,
+	};
+	gles2_begin(wlr_renderer, dst_attr->width, dst_attr->height);
+	gles2_clear(wlr_renderer, (float[]){ 0.0f, 0.0f, 0.0f, 0.0f });
+	ok = gles2_render_texture_with_matrix(wlr_renderer, src_tex, matrix,
+		1.0f);
+	gles2_end(wlr_renderer);
+
+	// Submit the blit, the client's reads are synchronized with it by the
+	// kernel's implicit DMA-BUF fences
+	glFlush();
+
+out:
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteRenderbuffers(1, &rbo);
+	POP_GLES2_DEBUG;
+
+	wlr_egl_destroy_image(renderer->egl, image);
+	wlr_texture_destroy(src_tex);
+	return ok;
+}
+
+/**
+ * Renders the `src_box` region of `src` into a new `width`x`height` texture,
+ * through the currently bound framebuffer.
+ */
+static struct wlr_texture *gles2_scale_pass(struct wlr_renderer *wlr_renderer,
+		struct wlr_texture *src, const struct wlr_box *src_box,
+		uint32_t width, uint32_t height) {
+	struct wlr_gles2_renderer *renderer = gles2_get_renderer(wlr_renderer);
+
+	struct wlr_texture *dst = wlr_gles2_texture_from_pixels(renderer->egl,
+		WL_SHM_FORMAT_ABGR8888, width * 4, width, height, NULL);
+	if (dst == NULL) {
+		return NULL;
+	}
+
+	PUSH_GLES2_DEBUG;
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		GL_TEXTURE_2D, gles2_get_texture(dst)->gl_tex, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	POP_GLES2_DEBUG;
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		wlr_log(WLR_ERROR, "Failed to create framebuffer for scaled copy");
+		wlr_texture_destroy(dst);
+		return NULL;
+	}
+
+	// Stretch the whole texture so that the source box covers the viewport,
+	// without flipping it (see gles2_blit_dmabuf)
+	int src_width, src_height;
+	wlr_texture_get_size(src, &src_width, &src_height);
+	const float matrix[9] = {
+		2.0f * src_width / src_box->width, 0.0f,
+		-1.0f - 2.0f * src_box->x / src_box->width,
+		0.0f, 2.0f * src_height / src_box->height,
+		-1.0f - 2.0f * src_box->y / src_box->height,
+		0.0f, 0.0f, 1.0f,
+	};
+	gles2_begin(wlr_renderer, width, height);
+	gles2_clear(wlr_renderer, (float[]){ 0.0f, 0.0f, 0.0f, 0.0f });
+	bool ok = gles2_render_texture_with_matrix(wlr_renderer, src, matrix,
+		1.0f);
+	gles2_end(wlr_renderer);
+	if (!ok) {
+		wlr_texture_destroy(dst);
+		return NULL;
+	}
+	return dst;
+}
+
+static bool gles2_read_dmabuf_scaled(struct wlr_renderer *wlr_renderer,
+		struct wlr_dmabuf_attributes *src_attr, const struct wlr_box *src_box,
+		enum wl_shm_format wl_fmt, uint32_t stride, uint32_t width,
+		uint32_t height, void *data) {
+	struct wlr_gles2_renderer *renderer = gles2_get_renderer(wlr_renderer);
+
+	const struct wlr_gles2_pixel_format *fmt = get_gles2_format_from_wl(wl_fmt);
+	if (fmt == NULL) {
+		wlr_log(WLR_ERROR, "Cannot read pixels: unsupported pixel format");
+		return false;
+	}
+	if (fmt->gl_format == GL_BGRA_EXT && !renderer->exts.read_format_bgra_ext) {
+		wlr_log(WLR_ERROR,
+			"Cannot read pixels: missing GL_EXT_read_format_bgra extension");
+		return false;
+	}
+
+	if (width == 0 || height == 0 || src_box->width <= 0 ||
+			src_box->height <= 0 || width > (uint32_t)src_box->width ||
+			height > (uint32_t)src_box->height) {
+		return false;
+	}
+
+	if (!wlr_egl_make_current(renderer->egl, EGL_NO_SURFACE, NULL)) {
+		return false;
+	}
+
+	struct wlr_texture *src_tex =
+		wlr_gles2_texture_from_dmabuf(renderer->egl, src_attr);
+	if (src_tex == NULL) {
+		return false;
+	}
+
+	PUSH_GLES2_DEBUG;
+
+	GLuint fbo = 0;
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+	// Halve the size at each pass, so that linear filtering averages all of
+	// the source pixels instead of skipping most of them
+	struct wlr_texture *tex = src_tex;
+	struct wlr_box box = *src_box;
+	do {
+		uint32_t pass_width = box.width / 2 > (int)width ?
+			(uint32_t)box.width / 2 : width;
+		uint32_t pass_height = box.height / 2 > (int)height ?
+			(uint32_t)box.height / 2 : height;
+		struct wlr_texture *pass_tex = gles2_scale_pass(wlr_renderer,
+			tex, &box, pass_width, pass_height);
+		wlr_texture_destroy(tex);
+		tex = pass_tex;
+		box = (struct wlr_box){ .width = pass_width, .height = pass_height };
+	} while (tex != NULL && (box.width > (int)width ||
+		box.height > (int)height));
+
+	bool ok = false;
+	if (tex == NULL) {
+		goto out;
+	}
+
+	// The last pass is still attached to the framebuffer, and is upright
+	glFinish();
+	glGetError(); // Clear the error flag
+
+	uint32_t pack_stride = width * fmt->bpp / 8;
+	if (pack_stride == stride) {
+		glReadPixels(0, 0, width, height, fmt->gl_format, fmt->gl_type, data);
+	} else {
+		for (size_t i = 0; i < height; ++i) {
+			glReadPixels(0, i, width, 1, fmt->gl_format, fmt->gl_type,
+				(unsigned char *)data + i * stride);
+		}
+	}
+	ok = glGetError() == GL_NO_ERROR;
+
+	wlr_texture_destroy(tex);
+
+out:
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fbo);
+	POP_GLES2_DEBUG;
+	return ok;
+}
+
+static int gles2_create_fence(struct wlr_renderer *wlr_renderer) {
+	struct wlr_gles2_renderer *renderer = gles2_get_renderer(wlr_renderer);
+	struct wlr_egl *egl = renderer->egl;
+
+	if (!wlr_egl_is_current(egl)) {
+		wlr_egl_make_current(egl, EGL_NO_SURFACE, NULL);
+	}
+
+	if (!egl->exts.native_fence_sync_android) {
+		glFinish();
+		return -1;
+	}
+
+	EGLSyncKHR sync = eglCreateSyncKHR(egl->display,
+		EGL_SYNC_NATIVE_FENCE_ANDROID, NULL);
+	if (sync == EGL_NO_SYNC_KHR) {
+		wlr_log(WLR_ERROR, "Failed to create EGL native fence");
+		glFinish();
+		return -1;
+	}
+
+	// The fence FD only becomes available once the fence has been flushed
+	glFlush();
+
+	int fd = eglDupNativeFenceFDANDROID(egl->display, sync);
+	eglDestroySyncKHR(egl->display, sync);
+	if (fd == EGL_NO_NATIVE_FENCE_FD_ANDROID) {
+		wlr_log(WLR_ERROR, "Failed to export EGL native fence");
+		glFinish();
+		return -1;
+	}
+	return fd;
+}
+
 static void gles2_destroy(struct wlr_renderer *wlr_renderer) {
 	struct wlr_gles2_renderer *renderer = gles2_get_renderer(wlr_renderer);
 
@@ -401,7 +645,10 @@ static const struct wlr_renderer_impl renderer_impl = {
 	.texture_from_pixels = gles2_texture_from_pixels,
 	.texture_from_wl_drm = gles2_texture_from_wl_drm,
 	.texture_from_dmabuf = gles2_texture_from_dmabuf,
+	.blit_dmabuf = gles2_blit_dmabuf,
+	.read_dmabuf_scaled = gles2_read_dmabuf_scaled,
 	.init_wl_display = gles2_init_wl_display,
+	.create_fence = gles2_create_fence,
 };
 
 void push_gles2_marker(const char *file, const char *func) {
@@ -108,6 +108,14 @@ static bool gles2_texture_to_dmabuf(struct wlr_texture *wlr_texture,
 		texture->width, texture->height, flags, attribs);
 }
 
+static bool gles2_texture_samples_dmabuf(struct wlr_texture *wlr_texture) {
+	struct wlr_gles2_texture *texture = gles2_get_texture(wlr_texture);
+	// DMA-BUF imports are bound to GL_TEXTURE_EXTERNAL_OES, which samples the
+	// EGLImage itself. GL_TEXTURE_2D targets may be backed by a copy of the
+	// image made when binding it, and would need to be re-bound instead.
+	return texture->type == WLR_GLES2_TEXTURE_DMABUF;
+}
+
 static void gles2_texture_destroy(struct wlr_texture *wlr_texture) {
 	if (wlr_texture == NULL) {
 		return;
@@ -140,6 +148,7 @@ static const struct wlr_texture_impl texture_impl = {
 	.is_opaque = gles2_texture_is_opaque,
 	.write_pixels = gles2_texture_write_pixels,
 	.to_dmabuf = gles2_texture_to_dmabuf,
+	.samples_dmabuf = gles2_texture_samples_dmabuf,
 	.destroy = gles2_texture_destroy,
 };
 
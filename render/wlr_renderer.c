@@ -8,6 +8,7 @@
 #include <wlr/types/wlr_matrix.h>
 #include <wlr/util/log.h>
 #include "util/signal.h"
+#include "util/trace.h"
 
 void wlr_renderer_init(struct wlr_renderer *renderer,
 		const struct wlr_renderer_impl *impl) {
@@ -21,6 +22,7 @@ void wlr_renderer_init(struct wlr_renderer *renderer,
 	assert(impl->format_supported);
 	assert(impl->texture_from_pixels);
 	renderer->impl = impl;
+	renderer->upload_stats = (struct wlr_buffer_upload_stats){0};
 
 	wl_signal_init(&renderer->events.destroy);
 }
@@ -39,6 +41,8 @@ void wlr_renderer_destroy(struct wlr_renderer *r) {
 }
 
 void wlr_renderer_begin(struct wlr_renderer *r, int width, int height) {
+	trace_point(WLR_TRACE_RENDER_BEGIN,
+		(uint64_t)width << 32 | (uint32_t)height);
 	r->impl->begin(r, width, height);
 }
 
@@ -46,6 +50,7 @@ void wlr_renderer_end(struct wlr_renderer *r) {
 	if (r->impl->end) {
 		r->impl->end(r);
 	}
+	trace_point(WLR_TRACE_RENDER_END, 0);
 }
 
 void wlr_renderer_clear(struct wlr_renderer *r, const float color[static 4]) {
@@ -142,6 +147,26 @@ bool wlr_renderer_read_pixels(struct wlr_renderer *r, enum wl_shm_format fmt,
 		src_x, src_y, dst_x, dst_y, data);
 }
 
+bool wlr_renderer_blit_dmabuf(struct wlr_renderer *r,
+		struct wlr_dmabuf_attributes *dst,
+		struct wlr_dmabuf_attributes *src) {
+	if (!r->impl->blit_dmabuf) {
+		return false;
+	}
+	return r->impl->blit_dmabuf(r, dst, src);
+}
+
+bool wlr_renderer_read_dmabuf_scaled(struct wlr_renderer *r,
+		struct wlr_dmabuf_attributes *src, const struct wlr_box *src_box,
+		enum wl_shm_format fmt, uint32_t stride, uint32_t width,
+		uint32_t height, void *data) {
+	if (!r->impl->read_dmabuf_scaled) {
+		return false;
+	}
+	return r->impl->read_dmabuf_scaled(r, src, src_box, fmt, stride,
+		width, height, data);
+}
+
 bool wlr_renderer_format_supported(struct wlr_renderer *r,
 		enum wl_shm_format fmt) {
 	return r->impl->format_supported(r, fmt);
@@ -178,6 +203,13 @@ void wlr_renderer_init_wl_display(struct wlr_renderer *r,
 	}
 }
 
+int wlr_renderer_create_fence(struct wlr_renderer *r) {
+	if (!r->impl->create_fence) {
+		return -1;
+	}
+	return r->impl->create_fence(r);
+}
+
 struct wlr_renderer *wlr_renderer_autocreate(struct wlr_egl *egl,
 		EGLenum platform, void *remote_display, EGLint *config_attribs,
 		EGLint visual_id) {
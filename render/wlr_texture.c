@@ -69,3 +69,10 @@ bool wlr_texture_to_dmabuf(struct wlr_texture *texture,
 	}
 	return texture->impl->to_dmabuf(texture, attribs);
 }
+
+bool wlr_texture_samples_dmabuf(struct wlr_texture *texture) {
+	if (!texture->impl->samples_dmabuf) {
+		return false;
+	}
+	return texture->impl->samples_dmabuf(texture);
+}
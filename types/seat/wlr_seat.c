@@ -10,9 +10,13 @@
 #include <wlr/types/wlr_seat.h>
 #include <wlr/util/log.h>
 #include "types/wlr_seat.h"
+#include "util/hash_map.h"
 #include "util/signal.h"
 
 #define SEAT_VERSION 7
+struct wlr_seat_state {
+	struct hash_map clients; // wlr_seat_client, keyed by wl_client
+};
 
 static void seat_handle_get_pointer(struct wl_client *client,
 		struct wl_resource *seat_resource, uint32_t id) {
@@ -94,6 +98,8 @@ static void seat_client_handle_resource_destroy(
 		wl_list_init(link);
 	}
 
+	hash_map_remove(&client->seat->state->clients,
+		hash_map_ptr_key(client->client));
 	wl_list_remove(&client->link);
 	free(client);
 }
@@ -141,6 +147,13 @@ static void seat_handle_bind(struct wl_client *client, void *_wlr_seat,
 		wl_list_init(&seat_client->data_devices);
 		wl_signal_init(&seat_client->events.destroy);
 
+		if (!hash_map_set(&wlr_seat->state->clients,
+				hash_map_ptr_key(client), seat_client)) {
+			free(seat_client);
+			wl_resource_destroy(wl_resource);
+			wl_client_post_no_memory(client);
+			return;
+		}
 		wl_list_insert(&wlr_seat->clients, &seat_client->link);
 	}
 
@@ -182,10 +195,16 @@ void wlr_seat_destroy(struct wlr_seat *seat) {
 		}
 	}
 
+	if (seat->pointer_state.coalesce.timer != NULL) {
+		wl_event_source_remove(seat->pointer_state.coalesce.timer);
+	}
+
 	wl_global_destroy(seat->global);
 	free(seat->pointer_state.default_grab);
 	free(seat->keyboard_state.default_grab);
 	free(seat->touch_state.default_grab);
+	hash_map_finish(&seat->state->clients);
+	free(seat->state);
 	free(seat->name);
 	free(seat);
 }
@@ -202,6 +221,13 @@ struct wlr_seat *wlr_seat_create(struct wl_display *display, const char *name) {
 		return NULL;
 	}
 
+	seat->state = calloc(1, sizeof(struct wlr_seat_state));
+	if (!seat->state) {
+		free(seat);
+		return NULL;
+	}
+	hash_map_init(&seat->state->clients);
+
 	// pointer state
 	seat->pointer_state.seat = seat;
 	wl_list_init(&seat->pointer_state.surface_destroy.link);
@@ -209,6 +235,7 @@ struct wlr_seat *wlr_seat_create(struct wl_display *display, const char *name) {
 	struct wlr_seat_pointer_grab *pointer_grab =
 		calloc(1, sizeof(struct wlr_seat_pointer_grab));
 	if (!pointer_grab) {
+		free(seat->state);
 		free(seat);
 		return NULL;
 	}
@@ -224,6 +251,7 @@ struct wlr_seat *wlr_seat_create(struct wl_display *display, const char *name) {
 		calloc(1, sizeof(struct wlr_seat_keyboard_grab));
 	if (!keyboard_grab) {
 		free(pointer_grab);
+		free(seat->state);
 		free(seat);
 		return NULL;
 	}
@@ -243,6 +271,7 @@ struct wlr_seat *wlr_seat_create(struct wl_display *display, const char *name) {
 	if (!touch_grab) {
 		free(pointer_grab);
 		free(keyboard_grab);
+		free(seat->state);
 		free(seat);
 		return NULL;
 	}
@@ -265,6 +294,7 @@ struct wlr_seat *wlr_seat_create(struct wl_display *display, const char *name) {
 		free(touch_grab);
 		free(pointer_grab);
 		free(keyboard_grab);
+		free(seat->state);
 		free(seat);
 		return NULL;
 	}
@@ -303,13 +333,7 @@ struct wlr_seat *wlr_seat_create(struct wl_display *display, const char *name) {
 
 struct wlr_seat_client *wlr_seat_client_for_wl_client(struct wlr_seat *wlr_seat,
 		struct wl_client *wl_client) {
-	struct wlr_seat_client *seat_client;
-	wl_list_for_each(seat_client, &wlr_seat->clients, link) {
-		if (seat_client->client == wl_client) {
-			return seat_client;
-		}
-	}
-	return NULL;
+	return hash_map_get(&wlr_seat->state->clients, hash_map_ptr_key(wl_client));
 }
 
 void wlr_seat_set_capabilities(struct wlr_seat *wlr_seat,
@@ -9,6 +9,7 @@
 #include "types/wlr_seat.h"
 #include "util/signal.h"
 #include "util/array.h"
+#include "util/trace.h"
 
 static void default_pointer_enter(struct wlr_seat_pointer_grab *grab,
 		struct wlr_surface *surface, double sx, double sy) {
@@ -136,6 +137,9 @@ void wlr_seat_pointer_enter(struct wlr_seat *wlr_seat,
 		return;
 	}
 
+	// buffered motion belongs to the previously entered surface
+	wlr_seat_pointer_flush_motion(wlr_seat);
+
 	struct wlr_seat_client *client = NULL;
 	if (surface) {
 		struct wl_client *wl_client = wl_resource_get_client(surface->resource);
@@ -210,6 +214,91 @@ void wlr_seat_pointer_clear_focus(struct wlr_seat *wlr_seat) {
 	wlr_seat_pointer_enter(wlr_seat, NULL, 0, 0);
 }
 
+static void pointer_send_motion(struct wlr_seat_client *client,
+		uint32_t time, double sx, double sy) {
+	struct wl_resource *resource;
+	wl_resource_for_each(resource, &client->pointers) {
+		if (wlr_seat_client_from_pointer_resource(resource) == NULL) {
+			continue;
+		}
+
+		wl_pointer_send_motion(resource, time, wl_fixed_from_double(sx),
+			wl_fixed_from_double(sy));
+	}
+}
+
+static int handle_coalesce_timer(void *data) {
+	struct wlr_seat *wlr_seat = data;
+	wlr_seat_pointer_flush_motion(wlr_seat);
+	return 0;
+}
+
+static void pointer_coalesce_motion(struct wlr_seat *wlr_seat,
+		uint32_t time) {
+	struct wlr_seat_pointer_state *state = &wlr_seat->pointer_state;
+	state->coalesce.time_msec = time;
+	if (state->coalesce.motion_pending) {
+		return;
+	}
+	state->coalesce.motion_pending = true;
+
+	if (state->coalesce.timer == NULL) {
+		struct wl_event_loop *loop =
+			wl_display_get_event_loop(wlr_seat->display);
+		state->coalesce.timer =
+			wl_event_loop_add_timer(loop, handle_coalesce_timer, wlr_seat);
+		if (state->coalesce.timer == NULL) {
+			wlr_log(WLR_ERROR, "Failed to create pointer coalescing timer");
+			wlr_seat_pointer_flush_motion(wlr_seat);
+			return;
+		}
+	}
+	wl_event_source_timer_update(state->coalesce.timer,
+		state->coalesce.max_delay_ms);
+}
+
+void wlr_seat_pointer_flush_motion(struct wlr_seat *wlr_seat) {
+	struct wlr_seat_pointer_state *state = &wlr_seat->pointer_state;
+	if (!state->coalesce.motion_pending) {
+		return;
+	}
+
+	bool frame_pending = state->coalesce.frame_pending;
+	state->coalesce.motion_pending = false;
+	state->coalesce.frame_pending = false;
+	if (state->coalesce.timer != NULL) {
+		wl_event_source_timer_update(state->coalesce.timer, 0);
+	}
+
+	struct wlr_seat_client *client = state->focused_client;
+	if (client == NULL) {
+		return;
+	}
+
+	pointer_send_motion(client, state->coalesce.time_msec, state->sx,
+		state->sy);
+	if (frame_pending) {
+		struct wl_resource *resource;
+		wl_resource_for_each(resource, &client->pointers) {
+			if (wlr_seat_client_from_pointer_resource(resource) == NULL) {
+				continue;
+			}
+
+			pointer_send_frame(resource);
+		}
+	}
+}
+
+void wlr_seat_pointer_set_motion_coalescing(struct wlr_seat *wlr_seat,
+		uint32_t max_delay_ms) {
+	wlr_seat_pointer_flush_motion(wlr_seat);
+	wlr_seat->pointer_state.coalesce.max_delay_ms = max_delay_ms;
+	if (max_delay_ms == 0 && wlr_seat->pointer_state.coalesce.timer != NULL) {
+		wl_event_source_remove(wlr_seat->pointer_state.coalesce.timer);
+		wlr_seat->pointer_state.coalesce.timer = NULL;
+	}
+}
+
 void wlr_seat_pointer_send_motion(struct wlr_seat *wlr_seat, uint32_t time,
 		double sx, double sy) {
 	struct wlr_seat_client *client = wlr_seat->pointer_state.focused_client;
@@ -221,22 +310,21 @@ void wlr_seat_pointer_send_motion(struct wlr_seat *wlr_seat, uint32_t time,
 		return;
 	}
 
-	struct wl_resource *resource;
-	wl_resource_for_each(resource, &client->pointers) {
-		if (wlr_seat_client_from_pointer_resource(resource) == NULL) {
-			continue;
-		}
+	wlr_seat->pointer_state.sx = sx;
+	wlr_seat->pointer_state.sy = sy;
 
-		wl_pointer_send_motion(resource, time, wl_fixed_from_double(sx),
-			wl_fixed_from_double(sy));
+	if (wlr_seat->pointer_state.coalesce.max_delay_ms > 0) {
+		pointer_coalesce_motion(wlr_seat, time);
+		return;
 	}
 
-	wlr_seat->pointer_state.sx = sx;
-	wlr_seat->pointer_state.sy = sy;
+	pointer_send_motion(client, time, sx, sy);
 }
 
 uint32_t wlr_seat_pointer_send_button(struct wlr_seat *wlr_seat, uint32_t time,
 		uint32_t button, enum wlr_button_state state) {
+	wlr_seat_pointer_flush_motion(wlr_seat);
+
 	struct wlr_seat_client *client = wlr_seat->pointer_state.focused_client;
 	if (client == NULL) {
 		return 0;
@@ -257,6 +345,8 @@ uint32_t wlr_seat_pointer_send_button(struct wlr_seat *wlr_seat, uint32_t time,
 void wlr_seat_pointer_send_axis(struct wlr_seat *wlr_seat, uint32_t time,
 		enum wlr_axis_orientation orientation, double value,
 		int32_t value_discrete, enum wlr_axis_source source) {
+	wlr_seat_pointer_flush_motion(wlr_seat);
+
 	struct wlr_seat_client *client = wlr_seat->pointer_state.focused_client;
 	if (client == NULL) {
 		return;
@@ -289,6 +379,12 @@ void wlr_seat_pointer_send_axis(struct wlr_seat *wlr_seat, uint32_t time,
 }
 
 void wlr_seat_pointer_send_frame(struct wlr_seat *wlr_seat) {
+	if (wlr_seat->pointer_state.coalesce.motion_pending) {
+		// sent along with the buffered motion
+		wlr_seat->pointer_state.coalesce.frame_pending = true;
+		return;
+	}
+
 	struct wlr_seat_client *client = wlr_seat->pointer_state.focused_client;
 	if (client == NULL) {
 		return;
@@ -333,6 +429,7 @@ void wlr_seat_pointer_notify_enter(struct wlr_seat *wlr_seat,
 void wlr_seat_pointer_notify_motion(struct wlr_seat *wlr_seat, uint32_t time,
 		double sx, double sy) {
 	clock_gettime(CLOCK_MONOTONIC, &wlr_seat->last_event);
+	trace_point(WLR_TRACE_POINTER_MOTION, time);
 	struct wlr_seat_pointer_grab *grab = wlr_seat->pointer_state.grab;
 	grab->interface->motion(grab, time, sx, sy);
 }
@@ -340,6 +437,7 @@ void wlr_seat_pointer_notify_motion(struct wlr_seat *wlr_seat, uint32_t time,
 uint32_t wlr_seat_pointer_notify_button(struct wlr_seat *wlr_seat,
 		uint32_t time, uint32_t button, enum wlr_button_state state) {
 	clock_gettime(CLOCK_MONOTONIC, &wlr_seat->last_event);
+	trace_point(WLR_TRACE_POINTER_BUTTON, button);
 
 	struct wlr_seat_pointer_state* pointer_state = &wlr_seat->pointer_state;
 
@@ -375,6 +473,7 @@ void wlr_seat_pointer_notify_axis(struct wlr_seat *wlr_seat, uint32_t time,
 		enum wlr_axis_orientation orientation, double value,
 		int32_t value_discrete, enum wlr_axis_source source) {
 	clock_gettime(CLOCK_MONOTONIC, &wlr_seat->last_event);
+	trace_point(WLR_TRACE_POINTER_AXIS, time);
 	struct wlr_seat_pointer_grab *grab = wlr_seat->pointer_state.grab;
 	grab->interface->axis(grab, time, orientation, value, value_discrete,
 		source);
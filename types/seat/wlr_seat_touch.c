@@ -8,6 +8,7 @@
 #include <wlr/util/log.h>
 #include "types/wlr_seat.h"
 #include "util/signal.h"
+#include "util/trace.h"
 
 static uint32_t default_touch_down(struct wlr_seat_touch_grab *grab,
 		uint32_t time, struct wlr_touch_point *point) {
@@ -174,6 +175,7 @@ uint32_t wlr_seat_touch_notify_down(struct wlr_seat *seat,
 		struct wlr_surface *surface, uint32_t time, int32_t touch_id, double sx,
 		double sy) {
 	clock_gettime(CLOCK_MONOTONIC, &seat->last_event);
+	trace_point(WLR_TRACE_TOUCH_DOWN, touch_id);
 	struct wlr_seat_touch_grab *grab = seat->touch_state.grab;
 	struct wlr_touch_point *point =
 		touch_point_create(seat, touch_id, surface, sx, sy);
@@ -200,6 +202,7 @@ uint32_t wlr_seat_touch_notify_down(struct wlr_seat *seat,
 void wlr_seat_touch_notify_up(struct wlr_seat *seat, uint32_t time,
 		int32_t touch_id) {
 	clock_gettime(CLOCK_MONOTONIC, &seat->last_event);
+	trace_point(WLR_TRACE_TOUCH_UP, touch_id);
 	struct wlr_seat_touch_grab *grab = seat->touch_state.grab;
 	struct wlr_touch_point *point = wlr_seat_touch_get_point(seat, touch_id);
 	if (!point) {
@@ -214,6 +217,7 @@ void wlr_seat_touch_notify_up(struct wlr_seat *seat, uint32_t time,
 void wlr_seat_touch_notify_motion(struct wlr_seat *seat, uint32_t time,
 		int32_t touch_id, double sx, double sy) {
 	clock_gettime(CLOCK_MONOTONIC, &seat->last_event);
+	trace_point(WLR_TRACE_TOUCH_MOTION, touch_id);
 	struct wlr_seat_touch_grab *grab = seat->touch_state.grab;
 	struct wlr_touch_point *point = wlr_seat_touch_get_point(seat, touch_id);
 	if (!point) {
@@ -4,6 +4,7 @@
 #include <wlr/types/wlr_buffer.h>
 #include <wlr/types/wlr_linux_dmabuf_v1.h>
 #include <wlr/util/log.h>
+#include "util/signal.h"
 
 bool wlr_resource_is_buffer(struct wl_resource *resource) {
 	return strcmp(wl_resource_get_class(resource), wl_buffer_interface.name) == 0;
@@ -35,10 +36,36 @@ bool wlr_buffer_get_resource_size(struct wl_resource *resource,
 }
 
 
+/**
+ * Returns the linux-dmabuf buffer whose cached texture has been lent to this
+ * buffer, if any.
+ */
+static struct wlr_dmabuf_v1_buffer *buffer_get_texture_lender(
+		struct wlr_buffer *buffer) {
+	if (buffer->resource == NULL ||
+			!wlr_dmabuf_v1_resource_is_buffer(buffer->resource)) {
+		return NULL;
+	}
+	struct wlr_dmabuf_v1_buffer *dmabuf =
+		wlr_dmabuf_v1_buffer_from_buffer_resource(buffer->resource);
+	if (dmabuf->texture == NULL || dmabuf->texture != buffer->texture) {
+		return NULL;
+	}
+	return dmabuf;
+}
+
 static void buffer_resource_handle_destroy(struct wl_listener *listener,
 		void *data) {
 	struct wlr_buffer *buffer =
 		wl_container_of(listener, buffer, resource_destroy);
+
+	// The linux-dmabuf buffer is about to be destroyed along with its cached
+	// texture, take ownership of the texture if we borrowed it
+	struct wlr_dmabuf_v1_buffer *lender = buffer_get_texture_lender(buffer);
+	if (lender != NULL) {
+		lender->texture = NULL;
+	}
+
 	wl_list_remove(&buffer->resource_destroy.link);
 	wl_list_init(&buffer->resource_destroy.link);
 	buffer->resource = NULL;
@@ -56,6 +83,7 @@ struct wlr_buffer *wlr_buffer_create(struct wlr_renderer *renderer,
 	assert(wlr_resource_is_buffer(resource));
 
 	struct wlr_texture *texture = NULL;
+	struct wlr_dmabuf_v1_buffer *lender = NULL;
 	bool released = false;
 
 	struct wl_shm_buffer *shm_buf = wl_shm_buffer_get(resource);
@@ -80,7 +108,18 @@ struct wlr_buffer *wlr_buffer_create(struct wlr_renderer *renderer,
 	} else if (wlr_dmabuf_v1_resource_is_buffer(resource)) {
 		struct wlr_dmabuf_v1_buffer *dmabuf =
 			wlr_dmabuf_v1_buffer_from_buffer_resource(resource);
-		texture = wlr_texture_from_dmabuf(renderer, &dmabuf->attributes);
+		if (dmabuf->texture != NULL && !dmabuf->texture_lent &&
+				dmabuf->renderer == renderer) {
+			// Re-use the texture imported previously, it samples the
+			// DMA-BUF directly so it's up to date with the buffer's contents
+			texture = dmabuf->texture;
+			dmabuf->texture_lent = true;
+			lender = dmabuf;
+		} else {
+			// The cached texture is unavailable or already in use (the same
+			// wl_buffer has been committed twice), import the DMA-BUF again
+			texture = wlr_texture_from_dmabuf(renderer, &dmabuf->attributes);
+		}
 
 		// We have imported the DMA-BUF, but we need to prevent the client from
 		// re-using the same DMA-BUF for the next frames, so we don't release
@@ -101,13 +140,19 @@ struct wlr_buffer *wlr_buffer_create(struct wlr_renderer *renderer,
 
 	struct wlr_buffer *buffer = calloc(1, sizeof(struct wlr_buffer));
 	if (buffer == NULL) {
-		wlr_texture_destroy(texture);
+		if (lender != NULL) {
+			lender->texture_lent = false;
+		} else {
+			wlr_texture_destroy(texture);
+		}
 		return NULL;
 	}
 	buffer->resource = resource;
+	buffer->renderer = renderer;
 	buffer->texture = texture;
 	buffer->released = released;
 	buffer->n_refs = 1;
+	wl_signal_init(&buffer->events.destroy);
 
 	wl_resource_add_destroy_listener(resource, &buffer->resource_destroy);
 	buffer->resource_destroy.notify = buffer_resource_handle_destroy;
@@ -131,15 +176,120 @@ void wlr_buffer_unref(struct wlr_buffer *buffer) {
 		return;
 	}
 
+	wlr_signal_emit_safe(&buffer->events.destroy, buffer);
+
 	if (!buffer->released && buffer->resource != NULL) {
 		wl_buffer_send_release(buffer->resource);
 	}
 
+	struct wlr_dmabuf_v1_buffer *lender = buffer_get_texture_lender(buffer);
+	if (lender != NULL) {
+		// Give the texture back to the linux-dmabuf buffer
+		lender->texture_lent = false;
+	} else {
+		wlr_texture_destroy(buffer->texture);
+	}
+
 	wl_list_remove(&buffer->resource_destroy.link);
-	wlr_texture_destroy(buffer->texture);
 	free(buffer);
 }
 
+/**
+ * Estimated overhead of a texture upload call, expressed in bytes of pixel
+ * data that could be uploaded in the same time.
+ */
+#define UPLOAD_CALL_COST (64 * 64 * 4)
+
+void wlr_buffer_get_upload_stats(struct wlr_renderer *renderer,
+		struct wlr_buffer_upload_stats *stats) {
+	*stats = renderer->upload_stats;
+}
+
+/**
+ * Returns the number of bytes per pixel of a wl_shm format, or zero if it's
+ * unknown.
+ */
+static int shm_format_bytes_per_pixel(enum wl_shm_format fmt) {
+	switch (fmt) {
+	case WL_SHM_FORMAT_ARGB8888:
+	case WL_SHM_FORMAT_XRGB8888:
+	case WL_SHM_FORMAT_ABGR8888:
+	case WL_SHM_FORMAT_XBGR8888:
+	case WL_SHM_FORMAT_RGBA8888:
+	case WL_SHM_FORMAT_RGBX8888:
+	case WL_SHM_FORMAT_BGRA8888:
+	case WL_SHM_FORMAT_BGRX8888:
+	case WL_SHM_FORMAT_ARGB2101010:
+	case WL_SHM_FORMAT_XRGB2101010:
+	case WL_SHM_FORMAT_ABGR2101010:
+	case WL_SHM_FORMAT_XBGR2101010:
+		return 4;
+	case WL_SHM_FORMAT_RGB888:
+	case WL_SHM_FORMAT_BGR888:
+		return 3;
+	case WL_SHM_FORMAT_RGB565:
+	case WL_SHM_FORMAT_BGR565:
+	case WL_SHM_FORMAT_ARGB4444:
+	case WL_SHM_FORMAT_XRGB4444:
+	case WL_SHM_FORMAT_ARGB1555:
+	case WL_SHM_FORMAT_XRGB1555:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+static size_t box_upload_cost(const pixman_box32_t *box, int bpp) {
+	return (size_t)(box->x2 - box->x1) * (box->y2 - box->y1) * bpp +
+		UPLOAD_CALL_COST;
+}
+
+/**
+ * Get the next box to upload, starting at rectangle `*i`. Consecutive
+ * rectangles (which are close to each other, since pixman sorts them in
+ * y-x bands) are merged as long as uploading their bounding box is cheaper
+ * than uploading them separately. Returns false when all rectangles have been
+ * consumed.
+ */
+static bool next_merged_box(const pixman_box32_t *rects, int n, int bpp,
+		int *i, pixman_box32_t *box) {
+	if (*i >= n) {
+		return false;
+	}
+
+	*box = rects[(*i)++];
+	while (*i < n) {
+		const pixman_box32_t *r = &rects[*i];
+		pixman_box32_t merged = {
+			.x1 = box->x1 < r->x1 ? box->x1 : r->x1,
+			.y1 = box->y1 < r->y1 ? box->y1 : r->y1,
+			.x2 = box->x2 > r->x2 ? box->x2 : r->x2,
+			.y2 = box->y2 > r->y2 ? box->y2 : r->y2,
+		};
+		if (box_upload_cost(&merged, bpp) >
+				box_upload_cost(box, bpp) + box_upload_cost(r, bpp)) {
+			break;
+		}
+		*box = merged;
+		(*i)++;
+	}
+	return true;
+}
+
+static bool texture_write_box(struct wlr_buffer *buffer, int32_t stride,
+		int bpp, const pixman_box32_t *r, void *data) {
+	struct wlr_texture *texture = buffer->texture;
+	if (!wlr_texture_write_pixels(texture, stride,
+			r->x2 - r->x1, r->y2 - r->y1, r->x1, r->y1,
+			r->x1, r->y1, data)) {
+		return false;
+	}
+	struct wlr_buffer_upload_stats *stats = &buffer->renderer->upload_stats;
+	stats->writes++;
+	stats->bytes += (size_t)(r->x2 - r->x1) * (r->y2 - r->y1) * bpp;
+	return true;
+}
+
 struct wlr_buffer *wlr_buffer_apply_damage(struct wlr_buffer *buffer,
 		struct wl_resource *resource, pixman_region32_t *damage) {
 	assert(wlr_resource_is_buffer(resource));
@@ -164,6 +314,12 @@ struct wlr_buffer *wlr_buffer_apply_damage(struct wlr_buffer *buffer,
 		return NULL;
 	}
 
+	int bpp = shm_format_bytes_per_pixel(new_fmt);
+	if (bpp == 0) {
+		// Can't estimate the upload costs, re-upload the whole buffer
+		return NULL;
+	}
+
 	int32_t stride = wl_shm_buffer_get_stride(shm_buf);
 	int32_t width = wl_shm_buffer_get_width(shm_buf);
 	int32_t height = wl_shm_buffer_get_height(shm_buf);
@@ -179,18 +335,47 @@ struct wlr_buffer *wlr_buffer_apply_damage(struct wlr_buffer *buffer,
 
 	int n;
 	pixman_box32_t *rects = pixman_region32_rectangles(damage, &n);
-	for (int i = 0; i < n; ++i) {
-		pixman_box32_t *r = &rects[i];
-		if (!wlr_texture_write_pixels(buffer->texture, stride,
-				r->x2 - r->x1, r->y2 - r->y1, r->x1, r->y1,
-				r->x1, r->y1, data)) {
-			wl_shm_buffer_end_access(shm_buf);
-			return NULL;
+
+	// Compare the cost of uploading the merged rectangles with uploading the
+	// damage extents at once
+	size_t merged_cost = 0;
+	int merged_n = 0;
+	pixman_box32_t box;
+	int i = 0;
+	while (next_merged_box(rects, n, bpp, &i, &box)) {
+		merged_cost += box_upload_cost(&box, bpp);
+		merged_n++;
+	}
+	pixman_box32_t *extents = pixman_region32_extents(damage);
+	bool use_extents = n > 1 && box_upload_cost(extents, bpp) < merged_cost;
+
+	struct wlr_buffer_upload_stats *stats = &buffer->renderer->upload_stats;
+	stats->uploads++;
+	stats->damage_rects += n;
+	if (use_extents) {
+		stats->extents++;
+	} else if (merged_n < n) {
+		stats->merged++;
+	} else {
+		stats->per_rect++;
+	}
+
+	bool ok = true;
+	if (use_extents) {
+		ok = texture_write_box(buffer, stride, bpp, extents, data);
+	} else {
+		i = 0;
+		while (ok && next_merged_box(rects, n, bpp, &i, &box)) {
+			ok = texture_write_box(buffer, stride, bpp, &box, data);
 		}
 	}
 
 	wl_shm_buffer_end_access(shm_buf);
 
+	if (!ok) {
+		return NULL;
+	}
+
 	// We have uploaded the data, we don't need to access the wl_buffer
 	// anymore
 	wl_buffer_send_release(resource);
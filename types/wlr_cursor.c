@@ -45,6 +45,7 @@ struct wlr_cursor_device {
 struct wlr_cursor_output_cursor {
 	struct wlr_cursor *cursor;
 	struct wlr_output_cursor *output_cursor;
+	struct wlr_output_layout_output *l_output;
 	struct wl_list link;
 
 	struct wl_listener layout_output_destroy;
@@ -200,13 +201,13 @@ static void cursor_warp_unchecked(struct wlr_cursor *cur,
 		double lx, double ly) {
 	assert(cur->state->layout);
 
+	// Use the layout output directly instead of looking each output up in
+	// the layout
 	struct wlr_cursor_output_cursor *output_cursor;
 	wl_list_for_each(output_cursor, &cur->state->output_cursors, link) {
-		double output_x = lx, output_y = ly;
-		wlr_output_layout_output_coords(cur->state->layout,
-			output_cursor->output_cursor->output, &output_x, &output_y);
+		struct wlr_output_layout_output *l_output = output_cursor->l_output;
 		wlr_output_cursor_move(output_cursor->output_cursor,
-			output_x, output_y);
+			lx - (double)l_output->x, ly - (double)l_output->y);
 	}
 
 	cur->x = lx;
@@ -720,6 +721,7 @@ static void layout_add(struct wlr_cursor_state *state,
 		return;
 	}
 	output_cursor->cursor = state->cursor;
+	output_cursor->l_output = l_output;
 
 	output_cursor->output_cursor = wlr_output_cursor_create(l_output->output);
 	if (output_cursor->output_cursor == NULL) {
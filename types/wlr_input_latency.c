@@ -0,0 +1,222 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wlr/types/wlr_input_latency.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/util/log.h>
+#include "util/signal.h"
+#include "util/time.h"
+
+static void histogram_add(struct wlr_input_latency_histogram *histogram,
+		uint64_t nsec) {
+	uint64_t usec = nsec / 1000;
+	size_t bucket = 0;
+	while (usec > 1 && bucket < WLR_INPUT_LATENCY_BUCKETS - 1) {
+		usec >>= 1;
+		bucket++;
+	}
+
+	histogram->buckets[bucket]++;
+	histogram->count++;
+	histogram->sum_nsec += nsec;
+	if (nsec > histogram->max_nsec) {
+		histogram->max_nsec = nsec;
+	}
+}
+
+uint64_t wlr_input_latency_histogram_percentile(
+		const struct wlr_input_latency_histogram *histogram,
+		double percentile) {
+	if (histogram->count == 0) {
+		return 0;
+	}
+
+	uint64_t rank = histogram->count * percentile / 100;
+	if (rank >= histogram->count) {
+		rank = histogram->count - 1;
+	}
+
+	uint64_t seen = 0;
+	for (size_t i = 0; i < WLR_INPUT_LATENCY_BUCKETS - 1; i++) {
+		seen += histogram->buckets[i];
+		if (seen > rank) {
+			uint64_t upper = (UINT64_C(2) << i) * 1000;
+			return upper < histogram->max_nsec ? upper : histogram->max_nsec;
+		}
+	}
+	return histogram->max_nsec;
+}
+
+static void latency_output_destroy(struct wlr_input_latency_output *l_output) {
+	wl_list_remove(&l_output->output_precommit.link);
+	wl_list_remove(&l_output->output_present.link);
+	wl_list_remove(&l_output->output_destroy.link);
+	wl_list_remove(&l_output->link);
+	free(l_output);
+}
+
+static void latency_output_handle_precommit(struct wl_listener *listener,
+		void *data) {
+	struct wlr_input_latency_output *l_output =
+		wl_container_of(listener, l_output, output_precommit);
+	struct wlr_output *output = l_output->output;
+
+	if (!(output->pending.committed & WLR_OUTPUT_STATE_BUFFER) ||
+			l_output->pending_nsec == 0) {
+		return;
+	}
+
+	// Latch the events at precommit, backends may send the present event
+	// from within the commit. If a previous commit has failed, its events
+	// are shown by this one, which gets the same sequence number.
+	if (l_output->frames_len > 0) {
+		struct wlr_input_latency_frame *last =
+			&l_output->frames[l_output->frames_len - 1];
+		if (last->commit_seq == output->commit_seq) {
+			if (l_output->pending_nsec < last->event_nsec) {
+				last->event_nsec = l_output->pending_nsec;
+			}
+			l_output->pending_nsec = 0;
+			return;
+		}
+	}
+
+	if (l_output->frames_len == WLR_INPUT_LATENCY_MAX_FRAMES) {
+		memmove(&l_output->frames[0], &l_output->frames[1],
+			(l_output->frames_len - 1) * sizeof(l_output->frames[0]));
+		l_output->frames_len--;
+	}
+
+	l_output->frames[l_output->frames_len++] = (struct wlr_input_latency_frame){
+		.commit_seq = output->commit_seq,
+		.event_nsec = l_output->pending_nsec,
+	};
+	l_output->pending_nsec = 0;
+}
+
+static void latency_output_handle_present(struct wl_listener *listener,
+		void *data) {
+	struct wlr_input_latency_output *l_output =
+		wl_container_of(listener, l_output, output_present);
+	struct wlr_output_event_present *event = data;
+
+	// Frames committed before the presented one have been superseded by it,
+	// their events reach the screen along with it
+	size_t n = 0;
+	while (n < l_output->frames_len &&
+			(int32_t)(l_output->frames[n].commit_seq - event->commit_seq) <= 0) {
+		n++;
+	}
+	if (n == 0) {
+		return;
+	}
+
+	// Frames which have not been presented have no timestamp to compare with
+	if (event->when != NULL) {
+		uint64_t when = timespec_to_nsec(event->when);
+		for (size_t i = 0; i < n; i++) {
+			uint64_t event_nsec = l_output->frames[i].event_nsec;
+			if (when >= event_nsec) {
+				histogram_add(&l_output->latency->present, when - event_nsec);
+			}
+		}
+	}
+
+	l_output->frames_len -= n;
+	memmove(&l_output->frames[0], &l_output->frames[n],
+		l_output->frames_len * sizeof(l_output->frames[0]));
+}
+
+static void latency_output_handle_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_input_latency_output *l_output =
+		wl_container_of(listener, l_output, output_destroy);
+	latency_output_destroy(l_output);
+}
+
+static struct wlr_input_latency_output *latency_get_output(
+		struct wlr_input_latency *latency, struct wlr_output *output) {
+	struct wlr_input_latency_output *l_output;
+	wl_list_for_each(l_output, &latency->outputs, link) {
+		if (l_output->output == output) {
+			return l_output;
+		}
+	}
+
+	l_output = calloc(1, sizeof(struct wlr_input_latency_output));
+	if (l_output == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+	l_output->latency = latency;
+	l_output->output = output;
+
+	l_output->output_precommit.notify = latency_output_handle_precommit;
+	wl_signal_add(&output->events.precommit, &l_output->output_precommit);
+	l_output->output_present.notify = latency_output_handle_present;
+	wl_signal_add(&output->events.present, &l_output->output_present);
+	l_output->output_destroy.notify = latency_output_handle_destroy;
+	wl_signal_add(&output->events.destroy, &l_output->output_destroy);
+
+	wl_list_insert(&latency->outputs, &l_output->link);
+	return l_output;
+}
+
+struct wlr_input_latency *wlr_input_latency_create(void) {
+	struct wlr_input_latency *latency =
+		calloc(1, sizeof(struct wlr_input_latency));
+	if (latency == NULL) {
+		return NULL;
+	}
+	wl_list_init(&latency->outputs);
+	wl_signal_init(&latency->events.destroy);
+	return latency;
+}
+
+void wlr_input_latency_destroy(struct wlr_input_latency *latency) {
+	if (latency == NULL) {
+		return;
+	}
+
+	wlr_signal_emit_safe(&latency->events.destroy, latency);
+
+	struct wlr_input_latency_output *l_output, *tmp;
+	wl_list_for_each_safe(l_output, tmp, &latency->outputs, link) {
+		latency_output_destroy(l_output);
+	}
+	free(latency);
+}
+
+void wlr_input_latency_record_dispatch(struct wlr_input_latency *latency,
+		uint64_t event_nsec) {
+	if (event_nsec == 0) {
+		return;
+	}
+
+	uint64_t now = get_current_time_nsec();
+	if (now >= event_nsec) {
+		histogram_add(&latency->dispatch, now - event_nsec);
+	}
+}
+
+void wlr_input_latency_record_damage(struct wlr_input_latency *latency,
+		struct wlr_output *output, uint64_t event_nsec) {
+	if (event_nsec == 0) {
+		return;
+	}
+
+	struct wlr_input_latency_output *l_output =
+		latency_get_output(latency, output);
+	if (l_output == NULL) {
+		return;
+	}
+
+	if (l_output->pending_nsec == 0 || event_nsec < l_output->pending_nsec) {
+		l_output->pending_nsec = event_nsec;
+	}
+}
+
+void wlr_input_latency_reset(struct wlr_input_latency *latency) {
+	memset(&latency->dispatch, 0, sizeof(latency->dispatch));
+	memset(&latency->present, 0, sizeof(latency->present));
+}
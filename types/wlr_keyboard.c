@@ -1,11 +1,15 @@
+#define _POSIX_C_SOURCE 200809L
 #include "util/array.h"
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <wayland-server-core.h>
 #include <wlr/interfaces/wlr_keyboard.h>
 #include <wlr/types/wlr_keyboard.h>
 #include <wlr/util/log.h>
+#include "util/shm.h"
 #include "util/signal.h"
 
 static void keyboard_led_update(struct wlr_keyboard *keyboard) {
@@ -114,6 +118,8 @@ void wlr_keyboard_init(struct wlr_keyboard *kb,
 	wl_signal_init(&kb->events.keymap);
 	wl_signal_init(&kb->events.repeat_info);
 
+	kb->keymap_fd = -1;
+
 	// Sane defaults
 	kb->repeat_info.rate = 25;
 	kb->repeat_info.delay = 600;
@@ -126,6 +132,9 @@ void wlr_keyboard_destroy(struct wlr_keyboard *kb) {
 	xkb_state_unref(kb->xkb_state);
 	xkb_keymap_unref(kb->keymap);
 	free(kb->keymap_string);
+	if (kb->keymap_fd >= 0) {
+		close(kb->keymap_fd);
+	}
 	if (kb->impl && kb->impl->destroy) {
 		kb->impl->destroy(kb);
 	} else {
@@ -186,6 +195,33 @@ void wlr_keyboard_set_keymap(struct wlr_keyboard *kb,
 	kb->keymap_string = tmp_keymap_string;
 	kb->keymap_size = strlen(kb->keymap_string) + 1;
 
+	// Serialize the keymap once, the read-only file is shared with all clients
+	int rw_fd = -1, ro_fd = -1;
+	if (!allocate_shm_file_pair(kb->keymap_size, &rw_fd, &ro_fd)) {
+		wlr_log(WLR_ERROR, "creating a keymap file for %zu bytes failed",
+			kb->keymap_size);
+		goto err;
+	}
+
+	void *dst = mmap(NULL, kb->keymap_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED, rw_fd, 0);
+	if (dst == MAP_FAILED) {
+		wlr_log_errno(WLR_ERROR, "failed to mmap() %zu bytes",
+			kb->keymap_size);
+		close(rw_fd);
+		close(ro_fd);
+		goto err;
+	}
+
+	memcpy(dst, kb->keymap_string, kb->keymap_size);
+	munmap(dst, kb->keymap_size);
+	close(rw_fd);
+
+	if (kb->keymap_fd >= 0) {
+		close(kb->keymap_fd);
+	}
+	kb->keymap_fd = ro_fd;
+
 	for (size_t i = 0; i < kb->num_keycodes; ++i) {
 		xkb_keycode_t keycode = kb->keycodes[i] + 8;
 		xkb_state_update_key(kb->xkb_state, keycode, XKB_KEY_DOWN);
@@ -203,6 +239,10 @@ err:
 	kb->keymap = NULL;
 	free(kb->keymap_string);
 	kb->keymap_string = NULL;
+	if (kb->keymap_fd >= 0) {
+		close(kb->keymap_fd);
+		kb->keymap_fd = -1;
+	}
 }
 
 void wlr_keyboard_set_repeat_info(struct wlr_keyboard *kb, int32_t rate,
@@ -54,6 +54,8 @@ struct wlr_dmabuf_v1_buffer *wlr_dmabuf_v1_buffer_from_buffer_resource(
 }
 
 static void linux_dmabuf_buffer_destroy(struct wlr_dmabuf_v1_buffer *buffer) {
+	wl_list_remove(&buffer->link);
+	wlr_texture_destroy(buffer->texture);
 	wlr_dmabuf_attributes_finish(&buffer->attributes);
 	free(buffer);
 }
@@ -122,15 +124,24 @@ static void buffer_handle_resource_destroy(struct wl_resource *buffer_resource)
 }
 
 static bool check_import_dmabuf(struct wlr_dmabuf_v1_buffer *buffer) {
+	if (buffer->renderer == NULL) {
+		return false;
+	}
+
 	struct wlr_texture *texture =
 		wlr_texture_from_dmabuf(buffer->renderer, &buffer->attributes);
 	if (texture == NULL) {
 		return false;
 	}
 
-	// We can import the image, good. No need to keep it since wlr_surface will
-	// import it again on commit.
-	wlr_texture_destroy(texture);
+	// We can import the image, good. If the texture always reflects the
+	// DMA-BUF's contents, keep it around so that wlr_buffer_create doesn't
+	// need to import it again on commit.
+	if (wlr_texture_samples_dmabuf(texture)) {
+		buffer->texture = texture;
+	} else {
+		wlr_texture_destroy(texture);
+	}
 	return true;
 }
 
@@ -357,6 +368,7 @@ static void linux_dmabuf_create_params(struct wl_client *client,
 
 	wl_resource_set_implementation(buffer->params_resource,
 		&linux_buffer_params_impl, buffer, handle_params_destroy);
+	wl_list_insert(&linux_dmabuf->buffers, &buffer->link);
 	return;
 
 err_free:
@@ -452,6 +464,20 @@ void wlr_linux_dmabuf_v1_destroy(struct wlr_linux_dmabuf_v1 *linux_dmabuf) {
 	wl_list_remove(&linux_dmabuf->display_destroy.link);
 	wl_list_remove(&linux_dmabuf->renderer_destroy.link);
 
+	// The renderer may be about to go away, drop the cached textures before
+	// it does. Textures currently lent to a wlr_buffer are now owned by it.
+	struct wlr_dmabuf_v1_buffer *buffer, *tmp_buffer;
+	wl_list_for_each_safe(buffer, tmp_buffer, &linux_dmabuf->buffers, link) {
+		if (!buffer->texture_lent) {
+			wlr_texture_destroy(buffer->texture);
+		}
+		buffer->texture = NULL;
+		buffer->texture_lent = false;
+		buffer->renderer = NULL;
+		wl_list_remove(&buffer->link);
+		wl_list_init(&buffer->link);
+	}
+
 	struct wl_resource *resource, *tmp;
 	wl_resource_for_each_safe(resource, tmp, &linux_dmabuf->resources) {
 		wl_resource_destroy(resource);
@@ -484,6 +510,7 @@ struct wlr_linux_dmabuf_v1 *wlr_linux_dmabuf_v1_create(struct wl_display *displa
 	linux_dmabuf->renderer = renderer;
 
 	wl_list_init(&linux_dmabuf->resources);
+	wl_list_init(&linux_dmabuf->buffers);
 	wl_signal_init(&linux_dmabuf->events.destroy);
 
 	linux_dmabuf->global =
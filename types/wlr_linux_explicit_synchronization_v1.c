@@ -0,0 +1,398 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assert.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/sync_file.h>
+#include <sys/ioctl.h>
+#endif
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/types/wlr_buffer.h>
+#include <wlr/types/wlr_linux_dmabuf_v1.h>
+#include <wlr/types/wlr_linux_explicit_synchronization_v1.h>
+#include <wlr/types/wlr_surface.h>
+#include <wlr/util/log.h>
+#include "linux-explicit-synchronization-unstable-v1-protocol.h"
+#include "util/signal.h"
+
+#define LINUX_EXPLICIT_SYNCHRONIZATION_V1_VERSION 1
+
+static const struct zwp_linux_explicit_synchronization_v1_interface
+	explicit_sync_impl;
+static const struct zwp_linux_surface_synchronization_v1_interface
+	surface_sync_impl;
+
+static bool is_sync_file(int fd) {
+#ifdef __linux__
+	struct sync_file_info info = {0};
+	return ioctl(fd, SYNC_IOC_FILE_INFO, &info) == 0;
+#else
+	// sync_file is Linux-specific, only check that the FD is valid
+	return fcntl(fd, F_GETFD) >= 0;
+#endif
+}
+
+// Returns NULL if the surface synchronization is inert
+static struct wlr_linux_surface_synchronization_v1 *
+		surface_sync_from_resource(struct wl_resource *resource) {
+	assert(wl_resource_instance_of(resource,
+		&zwp_linux_surface_synchronization_v1_interface,
+		&surface_sync_impl));
+	return wl_resource_get_user_data(resource);
+}
+
+static void buffer_release_handle_resource_destroy(
+		struct wl_resource *resource) {
+	struct wlr_linux_buffer_release_v1 *buffer_release =
+		wl_resource_get_user_data(resource);
+	if (buffer_release != NULL) {
+		buffer_release->resource = NULL;
+	}
+}
+
+static void buffer_release_finish(
+		struct wlr_linux_buffer_release_v1 *buffer_release) {
+	if (buffer_release->resource != NULL) {
+		wl_resource_set_user_data(buffer_release->resource, NULL);
+		wl_resource_destroy(buffer_release->resource);
+	}
+	wl_list_remove(&buffer_release->buffer_destroy.link);
+	free(buffer_release);
+}
+
+void wlr_linux_buffer_release_v1_destroy(
+		struct wlr_linux_buffer_release_v1 *buffer_release) {
+	if (buffer_release == NULL) {
+		return;
+	}
+	if (buffer_release->resource != NULL) {
+		zwp_linux_buffer_release_v1_send_immediate_release(
+			buffer_release->resource);
+	}
+	buffer_release_finish(buffer_release);
+}
+
+static void buffer_release_handle_buffer_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_linux_buffer_release_v1 *buffer_release =
+		wl_container_of(listener, buffer_release, buffer_destroy);
+
+	if (buffer_release->resource == NULL) {
+		buffer_release_finish(buffer_release);
+		return;
+	}
+
+	// The renderer may still be reading the buffer, let the client wait for
+	// the rendering commands submitted so far instead of stalling here
+	int fence_fd = wlr_renderer_create_fence(buffer_release->renderer);
+	if (fence_fd >= 0) {
+		zwp_linux_buffer_release_v1_send_fenced_release(
+			buffer_release->resource, fence_fd);
+		close(fence_fd);
+	} else {
+		zwp_linux_buffer_release_v1_send_immediate_release(
+			buffer_release->resource);
+	}
+	buffer_release_finish(buffer_release);
+}
+
+void wlr_linux_buffer_release_v1_attach(
+		struct wlr_linux_buffer_release_v1 *buffer_release,
+		struct wlr_buffer *buffer) {
+	if (buffer == NULL) {
+		wlr_linux_buffer_release_v1_destroy(buffer_release);
+		return;
+	}
+
+	assert(buffer_release->buffer == NULL);
+	buffer_release->buffer = buffer;
+	wl_signal_add(&buffer->events.destroy, &buffer_release->buffer_destroy);
+	buffer_release->buffer_destroy.notify =
+		buffer_release_handle_buffer_destroy;
+}
+
+static void surface_sync_reset_pending(
+		struct wlr_linux_surface_synchronization_v1 *surface_sync) {
+	if (surface_sync->pending_fence_fd >= 0) {
+		close(surface_sync->pending_fence_fd);
+		surface_sync->pending_fence_fd = -1;
+	}
+	wlr_linux_buffer_release_v1_destroy(surface_sync->pending_buffer_release);
+	surface_sync->pending_buffer_release = NULL;
+}
+
+static void surface_sync_destroy(
+		struct wlr_linux_surface_synchronization_v1 *surface_sync) {
+	if (surface_sync == NULL) {
+		return;
+	}
+	surface_sync_reset_pending(surface_sync);
+	wl_list_remove(&surface_sync->surface_destroy.link);
+	wl_list_remove(&surface_sync->surface_client_commit.link);
+	wl_resource_set_user_data(surface_sync->resource, NULL);
+	free(surface_sync);
+}
+
+static void surface_sync_handle_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static void surface_sync_handle_set_acquire_fence(struct wl_client *client,
+		struct wl_resource *resource, int fd) {
+	struct wlr_linux_surface_synchronization_v1 *surface_sync =
+		surface_sync_from_resource(resource);
+	if (surface_sync == NULL) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_SURFACE,
+			"the surface has been destroyed");
+		close(fd);
+		return;
+	}
+
+	if (surface_sync->pending_fence_fd >= 0) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_DUPLICATE_FENCE,
+			"a fence FD was already set for this commit");
+		close(fd);
+		return;
+	}
+
+	if (!is_sync_file(fd)) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_INVALID_FENCE,
+			"the fence FD is not a sync_file");
+		close(fd);
+		return;
+	}
+
+	surface_sync->pending_fence_fd = fd;
+}
+
+static void surface_sync_handle_get_release(struct wl_client *client,
+		struct wl_resource *resource, uint32_t id) {
+	struct wlr_linux_surface_synchronization_v1 *surface_sync =
+		surface_sync_from_resource(resource);
+	if (surface_sync == NULL) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_SURFACE,
+			"the surface has been destroyed");
+		return;
+	}
+
+	if (surface_sync->pending_buffer_release != NULL) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_DUPLICATE_RELEASE,
+			"a buffer release was already requested for this commit");
+		return;
+	}
+
+	struct wlr_linux_buffer_release_v1 *buffer_release =
+		calloc(1, sizeof(struct wlr_linux_buffer_release_v1));
+	if (buffer_release == NULL) {
+		wl_resource_post_no_memory(resource);
+		return;
+	}
+
+	uint32_t version = wl_resource_get_version(resource);
+	buffer_release->resource = wl_resource_create(client,
+		&zwp_linux_buffer_release_v1_interface, version, id);
+	if (buffer_release->resource == NULL) {
+		free(buffer_release);
+		wl_resource_post_no_memory(resource);
+		return;
+	}
+	wl_resource_set_implementation(buffer_release->resource, NULL,
+		buffer_release, buffer_release_handle_resource_destroy);
+
+	buffer_release->renderer = surface_sync->surface->renderer;
+	wl_list_init(&buffer_release->buffer_destroy.link);
+
+	surface_sync->pending_buffer_release = buffer_release;
+}
+
+static const struct zwp_linux_surface_synchronization_v1_interface
+		surface_sync_impl = {
+	.destroy = surface_sync_handle_destroy,
+	.set_acquire_fence = surface_sync_handle_set_acquire_fence,
+	.get_release = surface_sync_handle_get_release,
+};
+
+static void surface_sync_handle_resource_destroy(struct wl_resource *resource) {
+	struct wlr_linux_surface_synchronization_v1 *surface_sync =
+		surface_sync_from_resource(resource);
+	surface_sync_destroy(surface_sync);
+}
+
+static void surface_sync_handle_surface_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_linux_surface_synchronization_v1 *surface_sync =
+		wl_container_of(listener, surface_sync, surface_destroy);
+	surface_sync_destroy(surface_sync);
+}
+
+static void surface_sync_handle_surface_client_commit(
+		struct wl_listener *listener, void *data) {
+	struct wlr_linux_surface_synchronization_v1 *surface_sync =
+		wl_container_of(listener, surface_sync, surface_client_commit);
+	struct wlr_surface *surface = surface_sync->surface;
+
+	if (surface_sync->pending_fence_fd < 0 &&
+			surface_sync->pending_buffer_release == NULL) {
+		return;
+	}
+
+	struct wl_resource *buffer_resource = surface->pending.buffer_resource;
+	if (!(surface->pending.committed & WLR_SURFACE_STATE_BUFFER) ||
+			buffer_resource == NULL) {
+		wl_resource_post_error(surface_sync->resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_BUFFER,
+			"a fence or buffer release was set without attaching a buffer");
+		surface_sync_reset_pending(surface_sync);
+		return;
+	}
+	if (!wlr_dmabuf_v1_resource_is_buffer(buffer_resource)) {
+		wl_resource_post_error(surface_sync->resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_UNSUPPORTED_BUFFER,
+			"only linux-dmabuf buffers support explicit synchronization");
+		surface_sync_reset_pending(surface_sync);
+		return;
+	}
+
+	// The surface applies or caches its pending state right after this
+	// signal, and takes ownership of the fence and buffer release
+	assert(surface->pending.acquire_fence_fd < 0);
+	assert(surface->pending.buffer_release == NULL);
+	surface->pending.acquire_fence_fd = surface_sync->pending_fence_fd;
+	surface->pending.buffer_release = surface_sync->pending_buffer_release;
+	surface_sync->pending_fence_fd = -1;
+	surface_sync->pending_buffer_release = NULL;
+}
+
+static void explicit_sync_handle_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static void explicit_sync_handle_get_synchronization(struct wl_client *client,
+		struct wl_resource *resource, uint32_t id,
+		struct wl_resource *surface_resource) {
+	struct wlr_surface *surface = wlr_surface_from_resource(surface_resource);
+
+	if (wl_signal_get(&surface->events.destroy,
+			surface_sync_handle_surface_destroy) != NULL) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_EXPLICIT_SYNCHRONIZATION_V1_ERROR_SYNCHRONIZATION_EXISTS,
+			"zwp_linux_surface_synchronization_v1 already created for this "
+			"surface");
+		return;
+	}
+
+	struct wlr_linux_surface_synchronization_v1 *surface_sync =
+		calloc(1, sizeof(struct wlr_linux_surface_synchronization_v1));
+	if (surface_sync == NULL) {
+		wl_resource_post_no_memory(resource);
+		return;
+	}
+
+	uint32_t version = wl_resource_get_version(resource);
+	surface_sync->resource = wl_resource_create(client,
+		&zwp_linux_surface_synchronization_v1_interface, version, id);
+	if (surface_sync->resource == NULL) {
+		free(surface_sync);
+		wl_resource_post_no_memory(resource);
+		return;
+	}
+	wl_resource_set_implementation(surface_sync->resource,
+		&surface_sync_impl, surface_sync,
+		surface_sync_handle_resource_destroy);
+
+	surface_sync->surface = surface;
+	surface_sync->pending_fence_fd = -1;
+
+	surface_sync->surface_destroy.notify = surface_sync_handle_surface_destroy;
+	wl_signal_add(&surface->events.destroy, &surface_sync->surface_destroy);
+
+	surface_sync->surface_client_commit.notify =
+		surface_sync_handle_surface_client_commit;
+	wl_signal_add(&surface->events.client_commit,
+		&surface_sync->surface_client_commit);
+}
+
+static const struct zwp_linux_explicit_synchronization_v1_interface
+		explicit_sync_impl = {
+	.destroy = explicit_sync_handle_destroy,
+	.get_synchronization = explicit_sync_handle_get_synchronization,
+};
+
+static void explicit_sync_handle_resource_destroy(
+		struct wl_resource *resource) {
+	wl_list_remove(wl_resource_get_link(resource));
+}
+
+static void explicit_sync_bind(struct wl_client *client, void *data,
+		uint32_t version, uint32_t id) {
+	struct wlr_linux_explicit_synchronization_v1 *explicit_sync = data;
+
+	struct wl_resource *resource = wl_resource_create(client,
+		&zwp_linux_explicit_synchronization_v1_interface, version, id);
+	if (resource == NULL) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &explicit_sync_impl,
+		explicit_sync, explicit_sync_handle_resource_destroy);
+	wl_list_insert(&explicit_sync->resources, wl_resource_get_link(resource));
+}
+
+static void handle_display_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_linux_explicit_synchronization_v1 *explicit_sync =
+		wl_container_of(listener, explicit_sync, display_destroy);
+	wlr_linux_explicit_synchronization_v1_destroy(explicit_sync);
+}
+
+struct wlr_linux_explicit_synchronization_v1 *
+		wlr_linux_explicit_synchronization_v1_create(
+		struct wl_display *display) {
+	struct wlr_linux_explicit_synchronization_v1 *explicit_sync =
+		calloc(1, sizeof(struct wlr_linux_explicit_synchronization_v1));
+	if (explicit_sync == NULL) {
+		return NULL;
+	}
+
+	explicit_sync->global = wl_global_create(display,
+		&zwp_linux_explicit_synchronization_v1_interface,
+		LINUX_EXPLICIT_SYNCHRONIZATION_V1_VERSION, explicit_sync,
+		explicit_sync_bind);
+	if (explicit_sync->global == NULL) {
+		free(explicit_sync);
+		return NULL;
+	}
+
+	wl_list_init(&explicit_sync->resources);
+	wl_signal_init(&explicit_sync->events.destroy);
+
+	explicit_sync->display_destroy.notify = handle_display_destroy;
+	wl_display_add_destroy_listener(display, &explicit_sync->display_destroy);
+
+	return explicit_sync;
+}
+
+void wlr_linux_explicit_synchronization_v1_destroy(
+		struct wlr_linux_explicit_synchronization_v1 *explicit_sync) {
+	if (explicit_sync == NULL) {
+		return;
+	}
+
+	wlr_signal_emit_safe(&explicit_sync->events.destroy, explicit_sync);
+
+	struct wl_resource *resource, *tmp;
+	wl_resource_for_each_safe(resource, tmp, &explicit_sync->resources) {
+		wl_resource_destroy(resource);
+	}
+
+	wl_global_destroy(explicit_sync->global);
+	wl_list_remove(&explicit_sync->display_destroy.link);
+	free(explicit_sync);
+}
@@ -16,6 +16,7 @@
 #include <wlr/util/log.h>
 #include <wlr/util/region.h>
 #include "util/signal.h"
+#include "util/trace.h"
 
 #define OUTPUT_VERSION 3
 
@@ -495,6 +496,7 @@ bool wlr_output_commit(struct wlr_output *output) {
 		wlr_surface_send_frame_done(cursor->surface, &now);
 	}
 
+	trace_point(WLR_TRACE_OUTPUT_COMMIT, output->commit_seq);
 	wlr_signal_emit_safe(&output->events.commit, output);
 
 	output->frame_pending = true;
@@ -566,7 +568,9 @@ void wlr_output_schedule_frame(struct wlr_output *output) {
 
 void wlr_output_send_present(struct wlr_output *output,
 		struct wlr_output_event_present *event) {
-	struct wlr_output_event_present _event = {0};
+	struct wlr_output_event_present _event = {
+		.commit_seq = output->commit_seq,
+	};
 	if (event == NULL) {
 		event = &_event;
 	}
@@ -982,23 +986,26 @@ void wlr_output_cursor_set_surface(struct wlr_output_cursor *cursor,
 
 bool wlr_output_cursor_move(struct wlr_output_cursor *cursor,
 		double x, double y) {
+	x *= cursor->output->scale;
+	y *= cursor->output->scale;
 	if (cursor->x == x && cursor->y == y) {
 		return true;
 	}
 
-	if (cursor->output->hardware_cursor != cursor) {
+	// A software cursor which isn't visible isn't rendered, so there's
+	// nothing to damage at its old position
+	bool was_visible = cursor->visible;
+	if (was_visible && cursor->output->hardware_cursor != cursor) {
 		output_cursor_damage_whole(cursor);
 	}
 
-	bool was_visible = cursor->visible;
-	x *= cursor->output->scale;
-	y *= cursor->output->scale;
 	cursor->x = x;
 	cursor->y = y;
 	output_cursor_update_visible(cursor);
 
 	if (!was_visible && !cursor->visible) {
-		// Cursor is still hidden, do nothing
+		// Cursor is still off this output: don't damage it nor move the
+		// hardware cursor
 		return true;
 	}
 
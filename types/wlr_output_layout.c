@@ -7,9 +7,25 @@
 #include <wlr/types/wlr_output.h>
 #include <wlr/util/log.h>
 #include "util/signal.h"
+#include "util/vec.h"
+
+struct output_layout_box {
+	struct wlr_output *output;
+	struct wlr_output_layout_output *l_output;
+	struct wlr_box box;
+};
 
 struct wlr_output_layout_state {
 	struct wlr_box _box; // should never be read directly, use the getter
+
+	// Boxes of all outputs, in the order of wlr_output_layout::outputs. This
+	// is rebuilt whenever the layout is reconfigured, so that queries don't
+	// need to walk the output list and recompute the output sizes.
+	VEC(struct output_layout_box) boxes;
+	bool boxes_dirty;
+	struct wlr_box extents;
+	bool overlapping; // whether some output boxes intersect
+	size_t last_hit; // index of the box which last contained a point query
 };
 
 struct wlr_output_layout_output_state {
@@ -48,6 +64,7 @@ struct wlr_output_layout *wlr_output_layout_create(void) {
 static void output_layout_output_destroy(
 		struct wlr_output_layout_output *l_output) {
 	wlr_signal_emit_safe(&l_output->events.destroy, l_output);
+	l_output->state->layout->state->boxes_dirty = true;
 	wlr_output_destroy_global(l_output->output);
 	wl_list_remove(&l_output->state->mode.link);
 	wl_list_remove(&l_output->state->scale.link);
@@ -70,6 +87,7 @@ void wlr_output_layout_destroy(struct wlr_output_layout *layout) {
 		output_layout_output_destroy(l_output);
 	}
 
+	vec_finish(&layout->state->boxes);
 	free(layout->state);
 	free(layout);
 }
@@ -85,6 +103,77 @@ static struct wlr_box *output_layout_output_get_box(
 	return &l_output->state->_box;
 }
 
+static bool output_layout_update_boxes(struct wlr_output_layout *layout) {
+	struct wlr_output_layout_state *state = layout->state;
+	if (!state->boxes_dirty) {
+		return true;
+	}
+
+	if (!vec_reserve(&state->boxes, wl_list_length(&layout->outputs))) {
+		wlr_log(WLR_ERROR, "Failed to allocate output layout boxes");
+		vec_clear(&state->boxes);
+		return false;
+	}
+
+	int min_x = INT_MAX, min_y = INT_MAX, max_x = INT_MIN, max_y = INT_MIN;
+	vec_clear(&state->boxes);
+	state->overlapping = false;
+	struct wlr_output_layout_output *l_output;
+	wl_list_for_each(l_output, &layout->outputs, link) {
+		struct output_layout_box *entry =
+			&state->boxes.data[state->boxes.len];
+		entry->output = l_output->output;
+		entry->l_output = l_output;
+		entry->box = *output_layout_output_get_box(l_output);
+
+		struct wlr_box intersection;
+		for (size_t i = 0; i < state->boxes.len; i++) {
+			if (wlr_box_intersection(&intersection, &state->boxes.data[i].box,
+					&entry->box)) {
+				state->overlapping = true;
+			}
+		}
+		state->boxes.len++;
+
+		struct wlr_box *box = &entry->box;
+		if (box->x < min_x) {
+			min_x = box->x;
+		}
+		if (box->y < min_y) {
+			min_y = box->y;
+		}
+		if (box->x + box->width > max_x) {
+			max_x = box->x + box->width;
+		}
+		if (box->y + box->height > max_y) {
+			max_y = box->y + box->height;
+		}
+	}
+
+	if (state->boxes.len == 0) {
+		min_x = max_x = min_y = max_y = 0;
+	}
+	state->extents.x = min_x;
+	state->extents.y = min_y;
+	state->extents.width = max_x - min_x;
+	state->extents.height = max_y - min_y;
+
+	state->last_hit = 0;
+	state->boxes_dirty = false;
+	return true;
+}
+
+static struct output_layout_box *output_layout_find_box(
+		struct wlr_output_layout *layout, struct wlr_output *reference) {
+	output_layout_update_boxes(layout);
+	for (size_t i = 0; i < layout->state->boxes.len; i++) {
+		if (layout->state->boxes.data[i].output == reference) {
+			return &layout->state->boxes.data[i];
+		}
+	}
+	return NULL;
+}
+
 /**
  * This must be called whenever the layout changes to reconfigure the auto
  * configured outputs and emit the `changed` event.
@@ -127,6 +216,9 @@ static void output_layout_reconfigure(struct wlr_output_layout *layout) {
 		max_x += box->width;
 	}
 
+	layout->state->boxes_dirty = true;
+	output_layout_update_boxes(layout);
+
 	wlr_signal_emit_safe(&layout->events.change, layout);
 }
 
@@ -183,6 +275,7 @@ static struct wlr_output_layout_output *output_layout_output_create(
 	l_output->output = output;
 	wl_signal_init(&l_output->events.destroy);
 	wl_list_insert(&layout->outputs, &l_output->link);
+	layout->state->boxes_dirty = true;
 
 	wl_signal_add(&output->events.mode, &l_output->state->mode);
 	l_output->state->mode.notify = handle_output_mode;
@@ -234,10 +327,9 @@ struct wlr_output_layout_output *wlr_output_layout_get(
 bool wlr_output_layout_contains_point(struct wlr_output_layout *layout,
 		struct wlr_output *reference, int lx, int ly) {
 	if (reference) {
-		struct wlr_output_layout_output *l_output =
-			wlr_output_layout_get(layout, reference);
-		struct wlr_box *box = output_layout_output_get_box(l_output);
-		return wlr_box_contains_point(box, lx, ly);
+		struct output_layout_box *entry =
+			output_layout_find_box(layout, reference);
+		return entry != NULL && wlr_box_contains_point(&entry->box, lx, ly);
 	} else {
 		return !!wlr_output_layout_output_at(layout, lx, ly);
 	}
@@ -248,39 +340,54 @@ bool wlr_output_layout_intersects(struct wlr_output_layout *layout,
 	struct wlr_box out_box;
 
 	if (reference == NULL) {
-		struct wlr_output_layout_output *l_output;
-		wl_list_for_each(l_output, &layout->outputs, link) {
-			struct wlr_box *output_box =
-				output_layout_output_get_box(l_output);
-			if (wlr_box_intersection(&out_box, output_box, target_lbox)) {
+		output_layout_update_boxes(layout);
+		for (size_t i = 0; i < layout->state->boxes.len; i++) {
+			if (wlr_box_intersection(&out_box,
+					&layout->state->boxes.data[i].box, target_lbox)) {
 				return true;
 			}
 		}
 		return false;
 	} else {
-		struct wlr_output_layout_output *l_output =
-			wlr_output_layout_get(layout, reference);
-		if (!l_output) {
+		struct output_layout_box *entry =
+			output_layout_find_box(layout, reference);
+		if (!entry) {
 			return false;
 		}
 
-		struct wlr_box *output_box = output_layout_output_get_box(l_output);
-		return wlr_box_intersection(&out_box, output_box, target_lbox);
+		return wlr_box_intersection(&out_box, &entry->box, target_lbox);
 	}
 }
 
-struct wlr_output *wlr_output_layout_output_at(struct wlr_output_layout *layout,
-		double lx, double ly) {
-	struct wlr_output_layout_output *l_output;
-	wl_list_for_each(l_output, &layout->outputs, link) {
-		struct wlr_box *box = output_layout_output_get_box(l_output);
-		if (wlr_box_contains_point(box, lx, ly)) {
-			return l_output->output;
+static struct output_layout_box *output_layout_box_at(
+		struct wlr_output_layout *layout, double lx, double ly) {
+	struct wlr_output_layout_state *state = layout->state;
+	output_layout_update_boxes(layout);
+
+	// Consecutive queries, e.g. from cursor motion, usually hit the same
+	// output. This is only a valid shortcut if outputs don't overlap, because
+	// the first output in the list wins otherwise.
+	if (!state->overlapping && state->last_hit < state->boxes.len &&
+			wlr_box_contains_point(&state->boxes.data[state->last_hit].box,
+				lx, ly)) {
+		return &state->boxes.data[state->last_hit];
+	}
+
+	for (size_t i = 0; i < state->boxes.len; i++) {
+		if (wlr_box_contains_point(&state->boxes.data[i].box, lx, ly)) {
+			state->last_hit = i;
+			return &state->boxes.data[i];
 		}
 	}
 	return NULL;
 }
 
+struct wlr_output *wlr_output_layout_output_at(struct wlr_output_layout *layout,
+		double lx, double ly) {
+	struct output_layout_box *entry = output_layout_box_at(layout, lx, ly);
+	return entry != NULL ? entry->output : NULL;
+}
+
 void wlr_output_layout_move(struct wlr_output_layout *layout,
 		struct wlr_output *output, int lx, int ly) {
 	struct wlr_output_layout_output *l_output =
@@ -308,16 +415,10 @@ void wlr_output_layout_remove(struct wlr_output_layout *layout,
 void wlr_output_layout_output_coords(struct wlr_output_layout *layout,
 		struct wlr_output *reference, double *lx, double *ly) {
 	assert(layout && reference);
-	double src_x = *lx;
-	double src_y = *ly;
-
-	struct wlr_output_layout_output *l_output;
-	wl_list_for_each(l_output, &layout->outputs, link) {
-		if (l_output->output == reference) {
-			*lx = src_x - (double)l_output->x;
-			*ly = src_y - (double)l_output->y;
-			return;
-		}
+	struct output_layout_box *entry = output_layout_find_box(layout, reference);
+	if (entry != NULL) {
+		*lx -= (double)entry->box.x;
+		*ly -= (double)entry->box.y;
 	}
 }
 
@@ -329,15 +430,22 @@ void wlr_output_layout_closest_point(struct wlr_output_layout *layout,
 	}
 
 	double min_x = 0, min_y = 0, min_distance = DBL_MAX;
-	struct wlr_output_layout_output *l_output;
-	wl_list_for_each(l_output, &layout->outputs, link) {
-		if (reference != NULL && reference != l_output->output) {
+	if (reference == NULL && output_layout_box_at(layout, lx, ly) != NULL) {
+		// The point is inside the layout, it's its own closest point
+		min_x = lx;
+		min_y = ly;
+		goto out;
+	}
+
+	output_layout_update_boxes(layout);
+	for (size_t i = 0; i < layout->state->boxes.len; i++) {
+		struct output_layout_box *entry = &layout->state->boxes.data[i];
+		if (reference != NULL && reference != entry->output) {
 			continue;
 		}
 
 		double output_x, output_y, output_distance;
-		struct wlr_box *box = output_layout_output_get_box(l_output);
-		wlr_box_closest_point(box, lx, ly, &output_x, &output_y);
+		wlr_box_closest_point(&entry->box, lx, ly, &output_x, &output_y);
 
 		// calculate squared distance suitable for comparison
 		output_distance =
@@ -354,6 +462,7 @@ void wlr_output_layout_closest_point(struct wlr_output_layout *layout,
 		}
 	}
 
+out:
 	if (dest_lx) {
 		*dest_lx = min_x;
 	}
@@ -376,32 +485,8 @@ struct wlr_box *wlr_output_layout_get_box(
 		}
 	} else {
 		// layout extents
-		int min_x = 0, max_x = 0, min_y = 0, max_y = 0;
-		if (!wl_list_empty(&layout->outputs)) {
-			min_x = min_y = INT_MAX;
-			max_x = max_y = INT_MIN;
-			wl_list_for_each(l_output, &layout->outputs, link) {
-				struct wlr_box *box = output_layout_output_get_box(l_output);
-				if (box->x < min_x) {
-					min_x = box->x;
-				}
-				if (box->y < min_y) {
-					min_y = box->y;
-				}
-				if (box->x + box->width > max_x) {
-					max_x = box->x + box->width;
-				}
-				if (box->y + box->height > max_y) {
-					max_y = box->y + box->height;
-				}
-			}
-		}
-
-		layout->state->_box.x = min_x;
-		layout->state->_box.y = min_y;
-		layout->state->_box.width = max_x - min_x;
-		layout->state->_box.height = max_y - min_y;
-
+		output_layout_update_boxes(layout);
+		layout->state->_box = layout->state->extents;
 		return &layout->state->_box;
 	}
 
@@ -462,12 +547,13 @@ struct wlr_output *wlr_output_layout_output_in_direction(
 
 	double min_distance = (distance_method == NEAREST) ? DBL_MAX : DBL_MIN;
 	struct wlr_output *closest_output = NULL;
-	struct wlr_output_layout_output *l_output;
-	wl_list_for_each(l_output, &layout->outputs, link) {
-		if (reference != NULL && reference == l_output->output) {
+	output_layout_update_boxes(layout);
+	for (size_t i = 0; i < layout->state->boxes.len; i++) {
+		struct output_layout_box *entry = &layout->state->boxes.data[i];
+		if (reference != NULL && reference == entry->output) {
 			continue;
 		}
-		struct wlr_box *box = output_layout_output_get_box(l_output);
+		struct wlr_box *box = &entry->box;
 
 		bool match = false;
 		// test to make sure this output is in the given direction
@@ -489,8 +575,7 @@ struct wlr_output *wlr_output_layout_output_in_direction(
 
 		// calculate distance from the given reference point
 		double x, y;
-		wlr_output_layout_closest_point(layout, l_output->output,
-			ref_lx, ref_ly, &x, &y);
+		wlr_box_closest_point(box, ref_lx, ref_ly, &x, &y);
 		double distance =
 			(x - ref_lx) * (x - ref_lx) + (y - ref_ly) * (y - ref_ly);
 
@@ -498,7 +583,7 @@ struct wlr_output *wlr_output_layout_output_in_direction(
 				? distance < min_distance
 				: distance > min_distance) {
 			min_distance = distance;
-			closest_output = l_output->output;
+			closest_output = entry->output;
 		}
 	}
 	return closest_output;
@@ -1,14 +1,22 @@
+#define _POSIX_C_SOURCE 200809L
 #include <assert.h>
+#include <drm_fourcc.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wlr/render/interface.h>
 #include <wlr/render/wlr_renderer.h>
+#include <wlr/types/wlr_linux_dmabuf_v1.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_screencopy_v1.h>
 #include <wlr/backend.h>
 #include <wlr/util/log.h>
+#include "wlr-screencopy-scaled-unstable-v1-protocol.h"
 #include "wlr-screencopy-unstable-v1-protocol.h"
 #include "util/signal.h"
 
-#define SCREENCOPY_MANAGER_VERSION 2
+#define SCREENCOPY_MANAGER_VERSION 3
+#define SCREENCOPY_SCALED_MANAGER_VERSION 3
 
 struct screencopy_damage {
 	struct wl_list link;
@@ -19,6 +27,25 @@ struct screencopy_damage {
 	uint32_t last_commit_seq;
 };
 
+/**
+ * A copy of the parts of the output buffer being committed needed by the shm
+ * frames capturing this output, so that overlapping captures of the same
+ * commit only cost a single readback. Only exists while several frames are
+ * waiting for the same commit.
+ */
+struct screencopy_readback {
+	struct wl_list link; // wlr_screencopy_manager_v1::readbacks
+	struct wlr_output *output;
+	struct wl_listener output_destroy;
+
+	uint32_t commit_seq;
+	enum wl_shm_format format;
+	pixman_box32_t box; // area read back, in output buffer coordinates
+	uint32_t flags; // enum wlr_renderer_read_pixels_flags
+	int stride;
+	uint8_t *data;
+};
+
 static const struct zwlr_screencopy_frame_v1_interface frame_impl;
 
 static struct screencopy_damage *screencopy_damage_find(
@@ -106,6 +133,95 @@ static struct screencopy_damage *screencopy_damage_get_or_create(
 	return damage ? damage : screencopy_damage_create(client, output);
 }
 
+static void screencopy_readback_destroy(
+		struct screencopy_readback *readback) {
+	wl_list_remove(&readback->output_destroy.link);
+	wl_list_remove(&readback->link);
+	free(readback->data);
+	free(readback);
+}
+
+static void screencopy_readback_handle_output_destroy(
+		struct wl_listener *listener, void *data) {
+	struct screencopy_readback *readback =
+		wl_container_of(listener, readback, output_destroy);
+	screencopy_readback_destroy(readback);
+}
+
+static struct screencopy_readback *screencopy_readback_find(
+		struct wlr_screencopy_manager_v1 *manager,
+		struct wlr_output *output) {
+	struct screencopy_readback *readback;
+	wl_list_for_each(readback, &manager->readbacks, link) {
+		if (readback->output == output) {
+			return readback;
+		}
+	}
+	return NULL;
+}
+
+static struct screencopy_readback *screencopy_readback_create(
+		struct wlr_screencopy_manager_v1 *manager,
+		struct wlr_output *output) {
+	struct screencopy_readback *readback =
+		calloc(1, sizeof(struct screencopy_readback));
+	if (readback == NULL) {
+		return NULL;
+	}
+	readback->output = output;
+	readback->commit_seq = output->commit_seq - 1;
+	wl_list_insert(&manager->readbacks, &readback->link);
+
+	wl_signal_add(&output->events.destroy, &readback->output_destroy);
+	readback->output_destroy.notify =
+		screencopy_readback_handle_output_destroy;
+
+	return readback;
+}
+
+static bool screencopy_readback_contains(struct screencopy_readback *readback,
+		enum wl_shm_format format, const pixman_box32_t *box) {
+	return readback->commit_seq == readback->output->commit_seq &&
+		readback->format == format &&
+		box->x1 >= readback->box.x1 && box->y1 >= readback->box.y1 &&
+		box->x2 <= readback->box.x2 && box->y2 <= readback->box.y2;
+}
+
+/**
+ * Makes sure `box` (in output buffer coordinates) has been read from the
+ * buffer being committed into the staging buffer. The staging buffer is only
+ * read once per commit if it already contains `box`.
+ */
+static bool screencopy_readback_update(struct screencopy_readback *readback,
+		struct wlr_renderer *renderer, enum wl_shm_format format,
+		const pixman_box32_t *box) {
+	if (screencopy_readback_contains(readback, format, box)) {
+		return true;
+	}
+
+	int width = box->x2 - box->x1;
+	int height = box->y2 - box->y1;
+	int stride = width * 4;
+	uint8_t *data = realloc(readback->data, (size_t)stride * height);
+	if (data == NULL) {
+		wlr_log(WLR_ERROR, "Failed to allocate screencopy staging buffer");
+		return false;
+	}
+	readback->data = data;
+	readback->stride = stride;
+	// Invalidate the contents until they have been read back successfully
+	readback->commit_seq = readback->output->commit_seq - 1;
+
+	if (!wlr_renderer_read_pixels(renderer, format, &readback->flags, stride,
+			width, height, box->x1, box->y1, 0, 0, data)) {
+		return false;
+	}
+	readback->commit_seq = readback->output->commit_seq;
+	readback->format = format;
+	readback->box = *box;
+	return true;
+}
+
 static void client_unref(struct wlr_screencopy_v1_client *client) {
 	assert(client->ref > 0);
 
@@ -132,7 +248,8 @@ static void frame_destroy(struct wlr_screencopy_frame_v1 *frame) {
 	if (frame == NULL) {
 		return;
 	}
-	if (frame->output != NULL && frame->buffer != NULL) {
+	if (frame->output != NULL &&
+			(frame->buffer != NULL || frame->dma_buffer != NULL)) {
 		wlr_output_lock_attach_render(frame->output, false);
 		if (frame->cursor_locked) {
 			wlr_output_lock_software_cursors(frame->output, false);
@@ -140,6 +257,7 @@ static void frame_destroy(struct wlr_screencopy_frame_v1 *frame) {
 	}
 	wl_list_remove(&frame->link);
 	wl_list_remove(&frame->output_precommit.link);
+	wl_list_remove(&frame->output_commit.link);
 	wl_list_remove(&frame->output_destroy.link);
 	wl_list_remove(&frame->output_enable.link);
 	wl_list_remove(&frame->buffer_destroy.link);
@@ -149,11 +267,281 @@ static void frame_destroy(struct wlr_screencopy_frame_v1 *frame) {
 	free(frame);
 }
 
-static void frame_handle_output_precommit(struct wl_listener *listener,
-		void *_data) {
-	struct wlr_screencopy_frame_v1 *frame =
-		wl_container_of(listener, frame, output_precommit);
-	struct wlr_output_event_precommit *event = _data;
+/**
+ * Returns false if the frame waits for its box to be damaged and it hasn't
+ * been.
+ */
+static bool frame_is_damaged(struct wlr_screencopy_frame_v1 *frame) {
+	if (!frame->with_damage) {
+		return true;
+	}
+	struct screencopy_damage *damage =
+		screencopy_damage_get_or_create(frame->client, frame->output);
+	if (damage == NULL) {
+		return true;
+	}
+	screencopy_damage_accumulate(damage);
+	pixman_box32_t box = {
+		.x1 = frame->box.x,
+		.y1 = frame->box.y,
+		.x2 = frame->box.x + frame->box.width,
+		.y2 = frame->box.y + frame->box.height,
+	};
+	return pixman_region32_contains_rectangle(&damage->damage, &box) !=
+		PIXMAN_REGION_OUT;
+}
+
+static bool frame_is_scaled(struct wlr_screencopy_frame_v1 *frame) {
+	return frame->width != frame->box.width ||
+		frame->height != frame->box.height;
+}
+
+/**
+ * Returns true if the frame is going to copy the buffer being committed on
+ * `output` into a shm buffer of the given format, unscaled.
+ */
+static bool frame_waits_for_shm_copy(struct wlr_screencopy_frame_v1 *frame,
+		struct wlr_output *output, enum wl_shm_format format) {
+	return frame->output == output && frame->buffer != NULL &&
+		wl_shm_buffer_get_format(frame->buffer) == format &&
+		!frame_is_scaled(frame) &&
+		!wl_list_empty(&frame->output_precommit.link) &&
+		frame_is_damaged(frame);
+}
+
+/**
+ * Copies the frame's region of the current output buffer into the client's
+ * buffer, and sets `flags` to the enum wlr_renderer_read_pixels_flags the
+ * client's buffer has been written with.
+ *
+ * If other frames wait for this commit, the bounding box of the frames'
+ * regions is read once into a staging buffer shared by the frames, and each
+ * of them is copied from there. Otherwise, or if the bounding box is much
+ * larger than the frames' regions, the pixels are read straight into the
+ * client's buffer.
+ */
+static bool frame_shm_copy(struct wlr_screencopy_frame_v1 *frame,
+		struct wlr_renderer *renderer, uint32_t *flags) {
+	struct wlr_screencopy_manager_v1 *manager = frame->client->manager;
+	struct wlr_output *output = frame->output;
+	struct wl_shm_buffer *buffer = frame->buffer;
+	assert(buffer != NULL);
+
+	enum wl_shm_format format = wl_shm_buffer_get_format(buffer);
+	int32_t stride = wl_shm_buffer_get_stride(buffer);
+
+	pixman_box32_t frame_box = {
+		.x1 = frame->box.x,
+		.y1 = frame->box.y,
+		.x2 = frame->box.x + frame->box.width,
+		.y2 = frame->box.y + frame->box.height,
+	};
+
+	pixman_region32_t needed;
+	pixman_region32_init_rects(&needed, &frame_box, 1);
+	bool others_waiting = false;
+	struct wlr_screencopy_frame_v1 *other;
+	wl_list_for_each(other, &manager->frames, link) {
+		if (other != frame && frame_waits_for_shm_copy(other, output, format)) {
+			pixman_region32_union_rect(&needed, &needed,
+				other->box.x, other->box.y,
+				other->box.width, other->box.height);
+			others_waiting = true;
+		}
+	}
+	pixman_box32_t needed_box = *pixman_region32_extents(&needed);
+
+	// The staging buffer is read in a single call covering the bounding box
+	// of the frames, only share it if that box isn't mostly made of pixels
+	// none of them needs
+	uint64_t needed_area = 0;
+	int n_rects;
+	pixman_box32_t *rects = pixman_region32_rectangles(&needed, &n_rects);
+	for (int i = 0; i < n_rects; i++) {
+		needed_area += (uint64_t)(rects[i].x2 - rects[i].x1) *
+			(rects[i].y2 - rects[i].y1);
+	}
+	pixman_region32_fini(&needed);
+	uint64_t extents_area = (uint64_t)(needed_box.x2 - needed_box.x1) *
+		(needed_box.y2 - needed_box.y1);
+	bool shared = others_waiting && extents_area <= 2 * needed_area;
+
+	struct screencopy_readback *readback =
+		screencopy_readback_find(manager, output);
+	if (!shared && (readback == NULL ||
+			!screencopy_readback_contains(readback, format, &frame_box))) {
+		if (readback != NULL && !others_waiting) {
+			screencopy_readback_destroy(readback);
+		}
+
+		wl_shm_buffer_begin_access(buffer);
+		bool ok = wlr_renderer_read_pixels(renderer, format, flags, stride,
+			frame->box.width, frame->box.height, frame->box.x, frame->box.y,
+			0, 0, wl_shm_buffer_get_data(buffer));
+		wl_shm_buffer_end_access(buffer);
+		return ok;
+	}
+
+	if (readback == NULL) {
+		readback = screencopy_readback_create(manager, output);
+		if (readback == NULL) {
+			return false;
+		}
+	}
+	if (!screencopy_readback_update(readback, renderer, format, &needed_box)) {
+		screencopy_readback_destroy(readback);
+		return false;
+	}
+
+	// Keep the orientation of the staging buffer, the client is told about it
+	wl_shm_buffer_begin_access(buffer);
+	uint8_t *data = wl_shm_buffer_get_data(buffer);
+	size_t row_size = (size_t)frame->box.width * 4;
+	int src_x = frame->box.x - readback->box.x1;
+	for (int y = 0; y < frame->box.height; y++) {
+		int src_y = frame->box.y - readback->box.y1 + y;
+		if (readback->flags & WLR_RENDERER_READ_PIXELS_Y_INVERT) {
+			src_y = readback->box.y2 - frame_box.y2 + y;
+		}
+		memcpy(data + (size_t)y * stride,
+			readback->data + (size_t)src_y * readback->stride +
+			(size_t)src_x * 4, row_size);
+	}
+	wl_shm_buffer_end_access(buffer);
+	*flags = readback->flags;
+
+	if (!others_waiting) {
+		// This was the last frame waiting for this commit
+		screencopy_readback_destroy(readback);
+	}
+	return true;
+}
+
+/**
+ * Blits the whole output buffer which has just been committed into the
+ * client's DMA-BUF.
+ */
+static bool frame_dma_copy(struct wlr_screencopy_frame_v1 *frame,
+		struct wlr_renderer *renderer) {
+	struct wlr_dmabuf_attributes attr = {0};
+	if (!wlr_output_export_dmabuf(frame->output, &attr)) {
+		return false;
+	}
+
+	bool ok = wlr_renderer_blit_dmabuf(renderer,
+		&frame->dma_buffer->attributes, &attr);
+	wlr_dmabuf_attributes_finish(&attr);
+	return ok;
+}
+
+/**
+ * Returns true if the frame can be scaled down on the GPU, which requires the
+ * renderer to support it and the output buffer to be exported as a DMA-BUF.
+ * Other scaled frames are read back at full size and scaled down on the CPU.
+ */
+static bool frame_can_scale_on_gpu(struct wlr_screencopy_frame_v1 *frame) {
+	struct wlr_output *output = frame->output;
+	struct wlr_renderer *renderer = wlr_backend_get_renderer(output->backend);
+	if (!frame_is_scaled(frame) || renderer->impl->read_dmabuf_scaled == NULL) {
+		return false;
+	}
+
+	struct wlr_dmabuf_attributes attr = {0};
+	if (!wlr_output_export_dmabuf(output, &attr)) {
+		return false;
+	}
+	wlr_dmabuf_attributes_finish(&attr);
+	return true;
+}
+
+/**
+ * Scales the frame's region of the output buffer which has just been
+ * committed down on the GPU, and reads the result into the client's buffer.
+ */
+static bool frame_scaled_copy(struct wlr_screencopy_frame_v1 *frame,
+		struct wlr_renderer *renderer) {
+	struct wl_shm_buffer *buffer = frame->buffer;
+	assert(buffer != NULL);
+
+	struct wlr_dmabuf_attributes attr = {0};
+	if (!wlr_output_export_dmabuf(frame->output, &attr)) {
+		return false;
+	}
+
+	wl_shm_buffer_begin_access(buffer);
+	bool ok = wlr_renderer_read_dmabuf_scaled(renderer, &attr, &frame->box,
+		wl_shm_buffer_get_format(buffer), wl_shm_buffer_get_stride(buffer),
+		frame->width, frame->height, wl_shm_buffer_get_data(buffer));
+	wl_shm_buffer_end_access(buffer);
+
+	wlr_dmabuf_attributes_finish(&attr);
+	return ok;
+}
+
+/**
+ * Reads the frame's region of the current output buffer back at full size,
+ * and scales it down into the client's buffer by averaging the pixels covered
+ * by each of the client's buffer pixels. Sets `flags` like frame_shm_copy.
+ */
+static bool frame_scaled_shm_copy(struct wlr_screencopy_frame_v1 *frame,
+		struct wlr_renderer *renderer, uint32_t *flags) {
+	struct wl_shm_buffer *buffer = frame->buffer;
+	assert(buffer != NULL);
+
+	int src_width = frame->box.width;
+	int src_height = frame->box.height;
+	size_t src_stride = (size_t)src_width * 4;
+	uint8_t *src = malloc(src_stride * src_height);
+	if (src == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return false;
+	}
+	if (!wlr_renderer_read_pixels(renderer, wl_shm_buffer_get_format(buffer),
+			flags, src_stride, src_width, src_height,
+			frame->box.x, frame->box.y, 0, 0, src)) {
+		free(src);
+		return false;
+	}
+
+	// Keep the orientation of the pixels read back, the client is told about
+	// it. Frames are only ever scaled down, so each of the client's buffer
+	// pixels covers at least one source pixel.
+	int32_t stride = wl_shm_buffer_get_stride(buffer);
+	wl_shm_buffer_begin_access(buffer);
+	uint8_t *data = wl_shm_buffer_get_data(buffer);
+	for (int y = 0; y < frame->height; y++) {
+		int src_y1 = (int64_t)y * src_height / frame->height;
+		int src_y2 = (int64_t)(y + 1) * src_height / frame->height;
+		for (int x = 0; x < frame->width; x++) {
+			int src_x1 = (int64_t)x * src_width / frame->width;
+			int src_x2 = (int64_t)(x + 1) * src_width / frame->width;
+
+			uint64_t sum[4] = {0};
+			for (int sy = src_y1; sy < src_y2; sy++) {
+				const uint8_t *p = src + sy * src_stride +
+					(size_t)src_x1 * 4;
+				for (int sx = src_x1; sx < src_x2; sx++, p += 4) {
+					for (int i = 0; i < 4; i++) {
+						sum[i] += p[i];
+					}
+				}
+			}
+
+			uint64_t n = (uint64_t)(src_y2 - src_y1) * (src_x2 - src_x1);
+			uint8_t *dst = data + (size_t)y * stride + (size_t)x * 4;
+			for (int i = 0; i < 4; i++) {
+				dst[i] = (sum[i] + n / 2) / n;
+			}
+		}
+	}
+	wl_shm_buffer_end_access(buffer);
+
+	free(src);
+	return true;
+}
+
+static void frame_copy(struct wlr_screencopy_frame_v1 *frame,
+		struct timespec *when) {
 	struct wlr_output *output = frame->output;
 	struct wlr_renderer *renderer = wlr_backend_get_renderer(output->backend);
 	assert(renderer);
@@ -162,39 +550,56 @@ static void frame_handle_output_precommit(struct wl_listener *listener,
 		return;
 	}
 
+	// Damage in frame-local coordinates, if the client asked for it
 	struct screencopy_damage *damage = NULL;
+	pixman_region32_t frame_damage;
+	pixman_region32_init(&frame_damage);
 	if (frame->with_damage) {
 		damage = screencopy_damage_get_or_create(frame->client, output);
 		if (damage) {
 			screencopy_damage_accumulate(damage);
-			if (!pixman_region32_not_empty(&damage->damage)) {
+			pixman_region32_intersect_rect(&frame_damage, &damage->damage,
+				frame->box.x, frame->box.y,
+				frame->box.width, frame->box.height);
+			if (!pixman_region32_not_empty(&frame_damage)) {
+				pixman_region32_fini(&frame_damage);
 				return;
 			}
+			pixman_region32_translate(&frame_damage,
+				-frame->box.x, -frame->box.y);
+
+			// Damage is tracked per client and output, not per buffer, so
+			// the whole frame is always copied and the limit only applies to
+			// the damage events
+			int max_rects = frame->client->manager->max_damage_rects;
+			int n_rects = pixman_region32_n_rects(&frame_damage);
+			if (max_rects > 0 && n_rects > max_rects) {
+				pixman_box32_t extents =
+					*pixman_region32_extents(&frame_damage);
+				pixman_region32_fini(&frame_damage);
+				pixman_region32_init_rects(&frame_damage, &extents, 1);
+			}
 		}
 	}
 
 	wl_list_remove(&frame->output_precommit.link);
 	wl_list_init(&frame->output_precommit.link);
+	wl_list_remove(&frame->output_commit.link);
+	wl_list_init(&frame->output_commit.link);
 
-	int x = frame->box.x;
-	int y = frame->box.y;
-
-	struct wl_shm_buffer *buffer = frame->buffer;
-	assert(buffer != NULL);
-
-	enum wl_shm_format fmt = wl_shm_buffer_get_format(buffer);
-	int32_t width = wl_shm_buffer_get_width(buffer);
-	int32_t height = wl_shm_buffer_get_height(buffer);
-	int32_t stride = wl_shm_buffer_get_stride(buffer);
-
-	wl_shm_buffer_begin_access(buffer);
-	void *data = wl_shm_buffer_get_data(buffer);
+	bool ok;
 	uint32_t flags = 0;
-	bool ok = wlr_renderer_read_pixels(renderer, fmt, &flags, stride,
-		width, height, x, y, 0, 0, data);
-	wl_shm_buffer_end_access(buffer);
-
+	if (frame->dma_buffer != NULL) {
+		ok = frame_dma_copy(frame, renderer);
+	} else if (frame->scale_on_gpu) {
+		ok = frame_scaled_copy(frame, renderer);
+	} else if (frame_is_scaled(frame)) {
+		ok = frame_scaled_shm_copy(frame, renderer, &flags);
+	} else {
+		ok = frame_shm_copy(frame, renderer, &flags);
+	}
 	if (!ok) {
+		pixman_region32_fini(&frame_damage);
 		zwlr_screencopy_frame_v1_send_failed(frame->resource);
 		frame_destroy(frame);
 		return;
@@ -202,31 +607,57 @@ static void frame_handle_output_precommit(struct wl_listener *listener,
 
 	zwlr_screencopy_frame_v1_send_flags(frame->resource, flags);
 
-	// TODO: send fine-grained damage events
 	if (damage) {
-		struct pixman_box32 *damage_box =
-			pixman_region32_extents(&damage->damage);
-
-		int damage_x = damage_box->x1;
-		int damage_y = damage_box->y1;
-		int damage_width = damage_box->x2 - damage_box->x1;
-		int damage_height = damage_box->y2 - damage_box->y1;
-
-		zwlr_screencopy_frame_v1_send_damage(frame->resource,
-			damage_x, damage_y, damage_width, damage_height);
+		int n_rects;
+		pixman_box32_t *rects =
+			pixman_region32_rectangles(&frame_damage, &n_rects);
+		for (int i = 0; i < n_rects; i++) {
+			// Scale the damage to the client's buffer, rounding outwards
+			int64_t x1 = (int64_t)rects[i].x1 * frame->width / frame->box.width;
+			int64_t y1 = (int64_t)rects[i].y1 * frame->height / frame->box.height;
+			int64_t x2 = ((int64_t)rects[i].x2 * frame->width +
+				frame->box.width - 1) / frame->box.width;
+			int64_t y2 = ((int64_t)rects[i].y2 * frame->height +
+				frame->box.height - 1) / frame->box.height;
+			zwlr_screencopy_frame_v1_send_damage(frame->resource,
+				x1, y1, x2 - x1, y2 - y1);
+		}
 
 		pixman_region32_clear(&damage->damage);
 	}
+	pixman_region32_fini(&frame_damage);
 
-	time_t tv_sec = event->when->tv_sec;
+	time_t tv_sec = when->tv_sec;
 	uint32_t tv_sec_hi = (sizeof(tv_sec) > 4) ? tv_sec >> 32 : 0;
 	uint32_t tv_sec_lo = tv_sec & 0xFFFFFFFF;
 	zwlr_screencopy_frame_v1_send_ready(frame->resource,
-		tv_sec_hi, tv_sec_lo, event->when->tv_nsec);
+		tv_sec_hi, tv_sec_lo, when->tv_nsec);
 
 	frame_destroy(frame);
 }
 
+static void frame_handle_output_precommit(struct wl_listener *listener,
+		void *data) {
+	struct wlr_screencopy_frame_v1 *frame =
+		wl_container_of(listener, frame, output_precommit);
+	struct wlr_output_event_precommit *event = data;
+	frame_copy(frame, event->when);
+}
+
+static void frame_handle_output_commit(struct wl_listener *listener,
+		void *data) {
+	struct wlr_screencopy_frame_v1 *frame =
+		wl_container_of(listener, frame, output_commit);
+	struct wlr_output *output = frame->output;
+
+	// The output's DMA-BUF can only be exported once the new buffer has been
+	// submitted, so DMA-BUF copies are done after the commit
+	struct timespec now;
+	clockid_t clock = wlr_backend_get_presentation_clock(output->backend);
+	clock_gettime(clock, &now);
+	frame_copy(frame, &now);
+}
+
 static void frame_handle_output_enable(struct wl_listener *listener,
 		void *data) {
 	struct wlr_screencopy_frame_v1 *frame =
@@ -269,38 +700,63 @@ static void frame_handle_copy(struct wl_client *wl_client,
 		return;
 	}
 
-	struct wl_shm_buffer *buffer = wl_shm_buffer_get(buffer_resource);
-	if (buffer == NULL) {
-		wl_resource_post_error(frame->resource,
-			ZWLR_SCREENCOPY_FRAME_V1_ERROR_INVALID_BUFFER,
-			"unsupported buffer type");
-		return;
+	struct wl_shm_buffer *shm_buffer = wl_shm_buffer_get(buffer_resource);
+	struct wlr_dmabuf_v1_buffer *dma_buffer = NULL;
+	if (shm_buffer == NULL &&
+			wlr_dmabuf_v1_resource_is_buffer(buffer_resource)) {
+		dma_buffer =
+			wlr_dmabuf_v1_buffer_from_buffer_resource(buffer_resource);
 	}
 
-	enum wl_shm_format fmt = wl_shm_buffer_get_format(buffer);
-	int32_t width = wl_shm_buffer_get_width(buffer);
-	int32_t height = wl_shm_buffer_get_height(buffer);
-	int32_t stride = wl_shm_buffer_get_stride(buffer);
-	if (fmt != frame->format || width != frame->box.width ||
-			height != frame->box.height || stride != frame->stride) {
+	if (shm_buffer != NULL) {
+		enum wl_shm_format fmt = wl_shm_buffer_get_format(shm_buffer);
+		int32_t width = wl_shm_buffer_get_width(shm_buffer);
+		int32_t height = wl_shm_buffer_get_height(shm_buffer);
+		int32_t stride = wl_shm_buffer_get_stride(shm_buffer);
+		if (fmt != frame->format || width != frame->width ||
+				height != frame->height || stride != frame->stride) {
+			wl_resource_post_error(frame->resource,
+				ZWLR_SCREENCOPY_FRAME_V1_ERROR_INVALID_BUFFER,
+				"invalid buffer attributes");
+			return;
+		}
+	} else if (dma_buffer != NULL) {
+		struct wlr_dmabuf_attributes *attr = &dma_buffer->attributes;
+		if (frame->fourcc == DRM_FORMAT_INVALID ||
+				attr->format != frame->fourcc ||
+				attr->width != frame->width ||
+				attr->height != frame->height) {
+			wl_resource_post_error(frame->resource,
+				ZWLR_SCREENCOPY_FRAME_V1_ERROR_INVALID_BUFFER,
+				"invalid buffer attributes");
+			return;
+		}
+	} else {
 		wl_resource_post_error(frame->resource,
 			ZWLR_SCREENCOPY_FRAME_V1_ERROR_INVALID_BUFFER,
-			"invalid buffer attributes");
+			"unsupported buffer type");
 		return;
 	}
 
-	if (!wl_list_empty(&frame->output_precommit.link) ||
-			frame->buffer != NULL) {
+	if (frame->buffer != NULL || frame->dma_buffer != NULL) {
 		wl_resource_post_error(frame->resource,
 			ZWLR_SCREENCOPY_FRAME_V1_ERROR_ALREADY_USED,
 			"frame already used");
 		return;
 	}
 
-	frame->buffer = buffer;
+	frame->buffer = shm_buffer;
+	frame->dma_buffer = dma_buffer;
+	frame->scale_on_gpu = frame_can_scale_on_gpu(frame);
 
-	wl_signal_add(&output->events.precommit, &frame->output_precommit);
-	frame->output_precommit.notify = frame_handle_output_precommit;
+	if (dma_buffer != NULL || frame->scale_on_gpu) {
+		// These copies read the committed buffer from the GPU
+		wl_signal_add(&output->events.commit, &frame->output_commit);
+		frame->output_commit.notify = frame_handle_output_commit;
+	} else {
+		wl_signal_add(&output->events.precommit, &frame->output_precommit);
+		frame->output_precommit.notify = frame_handle_output_precommit;
+	}
 
 	wl_signal_add(&output->events.destroy, &frame->output_enable);
 	frame->output_enable.notify = frame_handle_output_enable;
@@ -362,7 +818,8 @@ static struct wlr_screencopy_v1_client *client_from_resource(
 static void capture_output(struct wl_client *wl_client,
 		struct wlr_screencopy_v1_client *client, uint32_t version,
 		uint32_t id, int32_t overlay_cursor, struct wlr_output *output,
-		const struct wlr_box *box) {
+		const struct wlr_box *box, int32_t buffer_width,
+		int32_t buffer_height) {
 	struct wlr_screencopy_frame_v1 *frame =
 		calloc(1, sizeof(struct wlr_screencopy_frame_v1));
 	if (frame == NULL) {
@@ -389,6 +846,7 @@ static void capture_output(struct wl_client *wl_client,
 	wl_list_insert(&client->manager->frames, &frame->link);
 
 	wl_list_init(&frame->output_precommit.link);
+	wl_list_init(&frame->output_commit.link);
 	wl_list_init(&frame->output_enable.link);
 	wl_list_init(&frame->output_destroy.link);
 	wl_list_init(&frame->buffer_destroy.link);
@@ -421,13 +879,52 @@ static void capture_output(struct wl_client *wl_client,
 		buffer_box.y *= output->scale;
 		buffer_box.width *= output->scale;
 		buffer_box.height *= output->scale;
+
+		// Frames are read back from the output buffer, never read past it
+		struct wlr_box output_box = {
+			.width = output->width,
+			.height = output->height,
+		};
+		if (!wlr_box_intersection(&buffer_box, &buffer_box, &output_box)) {
+			goto error;
+		}
 	}
 
 	frame->box = buffer_box;
-	frame->stride = 4 * buffer_box.width; // TODO: depends on read format
+	frame->width = buffer_box.width;
+	frame->height = buffer_box.height;
+	// Only scale down, zero means no scaling
+	if (buffer_width > 0 && buffer_width < buffer_box.width) {
+		frame->width = buffer_width;
+	}
+	if (buffer_height > 0 && buffer_height < buffer_box.height) {
+		frame->height = buffer_height;
+	}
+	frame->stride = 4 * frame->width; // TODO: depends on read format
 
 	zwlr_screencopy_frame_v1_send_buffer(frame->resource, frame->format,
-		buffer_box.width, buffer_box.height, frame->stride);
+		frame->width, frame->height, frame->stride);
+
+	// DMA-BUF copies are a blit of the whole output buffer, and only version 3
+	// clients can be offered them
+	frame->fourcc = DRM_FORMAT_INVALID;
+	struct wlr_dmabuf_attributes attr = {0};
+	if (version >= 3 && !frame_is_scaled(frame) &&
+			buffer_box.x == 0 && buffer_box.y == 0 &&
+			buffer_box.width == output->width &&
+			buffer_box.height == output->height &&
+			wlr_output_export_dmabuf(output, &attr)) {
+		frame->fourcc = attr.format;
+		wlr_dmabuf_attributes_finish(&attr);
+	}
+
+	if (version >= 3) {
+		if (frame->fourcc != DRM_FORMAT_INVALID) {
+			zwlr_screencopy_frame_v1_send_linux_dmabuf(frame->resource,
+				frame->fourcc, buffer_box.width, buffer_box.height);
+		}
+		zwlr_screencopy_frame_v1_send_buffer_done(frame->resource);
+	}
 	return;
 
 error:
@@ -444,7 +941,7 @@ static void manager_handle_capture_output(struct wl_client *wl_client,
 	struct wlr_output *output = wlr_output_from_resource(output_resource);
 
 	capture_output(wl_client, client, version, id, overlay_cursor, output,
-		NULL);
+		NULL, 0, 0);
 }
 
 static void manager_handle_capture_output_region(struct wl_client *wl_client,
@@ -463,7 +960,7 @@ static void manager_handle_capture_output_region(struct wl_client *wl_client,
 		.height = height,
 	};
 	capture_output(wl_client, client, version, id, overlay_cursor, output,
-		&box);
+		&box, 0, 0);
 }
 
 static void manager_handle_destroy(struct wl_client *wl_client,
@@ -515,6 +1012,89 @@ failure:
 	wl_client_post_no_memory(wl_client);
 }
 
+static const struct zwlr_screencopy_scaled_manager_v1_interface
+	scaled_manager_impl;
+
+static struct wlr_screencopy_v1_client *scaled_client_from_resource(
+		struct wl_resource *resource) {
+	assert(wl_resource_instance_of(resource,
+		&zwlr_screencopy_scaled_manager_v1_interface, &scaled_manager_impl));
+	return wl_resource_get_user_data(resource);
+}
+
+static void scaled_manager_handle_capture_output_region(
+		struct wl_client *wl_client, struct wl_resource *manager_resource,
+		uint32_t id, int32_t overlay_cursor,
+		struct wl_resource *output_resource, int32_t x, int32_t y,
+		int32_t width, int32_t height, int32_t buffer_width,
+		int32_t buffer_height) {
+	struct wlr_screencopy_v1_client *client =
+		scaled_client_from_resource(manager_resource);
+	uint32_t version = wl_resource_get_version(manager_resource);
+	struct wlr_output *output = wlr_output_from_resource(output_resource);
+
+	if (buffer_width <= 0 || buffer_height <= 0) {
+		wl_resource_post_error(manager_resource,
+			ZWLR_SCREENCOPY_SCALED_MANAGER_V1_ERROR_INVALID_SIZE,
+			"invalid buffer size %dx%d", buffer_width, buffer_height);
+		return;
+	}
+
+	struct wlr_box box = {
+		.x = x,
+		.y = y,
+		.width = width,
+		.height = height,
+	};
+	capture_output(wl_client, client, version, id, overlay_cursor, output,
+		&box, buffer_width, buffer_height);
+}
+
+static const struct zwlr_screencopy_scaled_manager_v1_interface
+		scaled_manager_impl = {
+	.capture_output_region = scaled_manager_handle_capture_output_region,
+	.destroy = manager_handle_destroy,
+};
+
+static void scaled_manager_handle_resource_destroy(
+		struct wl_resource *resource) {
+	struct wlr_screencopy_v1_client *client =
+		scaled_client_from_resource(resource);
+	client_unref(client);
+	wl_list_remove(wl_resource_get_link(resource));
+}
+
+static void scaled_manager_bind(struct wl_client *wl_client, void *data,
+		uint32_t version, uint32_t id) {
+	struct wlr_screencopy_manager_v1 *manager = data;
+
+	struct wlr_screencopy_v1_client *client =
+		calloc(1, sizeof(struct wlr_screencopy_v1_client));
+	if (client == NULL) {
+		goto failure;
+	}
+
+	struct wl_resource *resource = wl_resource_create(wl_client,
+		&zwlr_screencopy_scaled_manager_v1_interface, version, id);
+	if (resource == NULL) {
+		goto failure;
+	}
+
+	client->ref = 1;
+	client->manager = manager;
+	wl_list_init(&client->damages);
+
+	wl_resource_set_implementation(resource, &scaled_manager_impl, client,
+		scaled_manager_handle_resource_destroy);
+
+	wl_list_insert(&manager->resources, wl_resource_get_link(resource));
+
+	return;
+failure:
+	free(client);
+	wl_client_post_no_memory(wl_client);
+}
+
 static void handle_display_destroy(struct wl_listener *listener, void *data) {
 	struct wlr_screencopy_manager_v1 *manager =
 		wl_container_of(listener, manager, display_destroy);
@@ -536,8 +1116,19 @@ struct wlr_screencopy_manager_v1 *wlr_screencopy_manager_v1_create(
 		free(manager);
 		return NULL;
 	}
+
+	manager->scaled_global = wl_global_create(display,
+		&zwlr_screencopy_scaled_manager_v1_interface,
+		SCREENCOPY_SCALED_MANAGER_VERSION, manager, scaled_manager_bind);
+	if (manager->scaled_global == NULL) {
+		wl_global_destroy(manager->global);
+		free(manager);
+		return NULL;
+	}
+
 	wl_list_init(&manager->resources);
 	wl_list_init(&manager->frames);
+	wl_list_init(&manager->readbacks);
 
 	wl_signal_init(&manager->events.destroy);
 
@@ -558,10 +1149,15 @@ void wlr_screencopy_manager_v1_destroy(
 	wl_list_for_each_safe(frame, tmp_frame, &manager->frames, link) {
 		wl_resource_destroy(frame->resource);
 	}
+	struct screencopy_readback *readback, *tmp_readback;
+	wl_list_for_each_safe(readback, tmp_readback, &manager->readbacks, link) {
+		screencopy_readback_destroy(readback);
+	}
 	struct wl_resource *resource, *tmp_resource;
 	wl_resource_for_each_safe(resource, tmp_resource, &manager->resources) {
 		wl_resource_destroy(resource);
 	}
+	wl_global_destroy(manager->scaled_global);
 	wl_global_destroy(manager->global);
 	free(manager);
 }
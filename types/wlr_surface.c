@@ -1,16 +1,22 @@
+#define _POSIX_C_SOURCE 200809L
 #include <assert.h>
+#include <poll.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <wayland-server-core.h>
 #include <wlr/render/interface.h>
 #include <wlr/types/wlr_buffer.h>
 #include <wlr/types/wlr_compositor.h>
+#include <wlr/types/wlr_linux_explicit_synchronization_v1.h>
 #include <wlr/types/wlr_matrix.h>
 #include <wlr/types/wlr_region.h>
 #include <wlr/types/wlr_surface.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/util/log.h>
 #include <wlr/util/region.h>
+#include "types/wlr_surface.h"
 #include "util/signal.h"
+#include "util/trace.h"
 
 #define CALLBACK_VERSION 1
 #define SURFACE_VERSION 4
@@ -169,20 +175,24 @@ static void surface_state_finalize(struct wlr_surface *surface,
 
 static void surface_update_damage(pixman_region32_t *buffer_damage,
 		struct wlr_surface_state *current, struct wlr_surface_state *pending) {
-	pixman_region32_clear(buffer_damage);
+	// The previous damage is overwritten below rather than cleared first, so
+	// that pixman can re-use the region's rectangle storage between commits
 
 	if (pending->width != current->width ||
 			pending->height != current->height) {
 		// Damage the whole buffer on resize
-		pixman_region32_union_rect(buffer_damage, buffer_damage, 0, 0,
+		pixman_region32_fini(buffer_damage);
+		pixman_region32_init_rect(buffer_damage, 0, 0,
 			pending->buffer_width, pending->buffer_height);
+	} else if (!pixman_region32_not_empty(&pending->surface_damage)) {
+		// Most clients only send buffer damage, no need to transform anything
+		pixman_region32_copy(buffer_damage, &pending->buffer_damage);
 	} else {
 		// Copy over surface damage + buffer damage
 		pixman_region32_t surface_damage;
 		pixman_region32_init(&surface_damage);
 
-		pixman_region32_copy(&surface_damage, &pending->surface_damage);
-		wlr_region_transform(&surface_damage, &surface_damage,
+		wlr_region_transform(&surface_damage, &pending->surface_damage,
 			wlr_output_transform_invert(pending->transform),
 			pending->width, pending->height);
 		wlr_region_scale(&surface_damage, &surface_damage, pending->scale);
@@ -256,6 +266,19 @@ static void surface_state_move(struct wlr_surface_state *state,
 			&next->frame_callback_list);
 		wl_list_init(&next->frame_callback_list);
 	}
+	if (next->acquire_fence_fd >= 0) {
+		if (state->acquire_fence_fd >= 0) {
+			close(state->acquire_fence_fd);
+		}
+		state->acquire_fence_fd = next->acquire_fence_fd;
+		next->acquire_fence_fd = -1;
+	}
+	if (next->buffer_release != NULL) {
+		// The buffer this release was committed with is superseded
+		wlr_linux_buffer_release_v1_destroy(state->buffer_release);
+		state->buffer_release = next->buffer_release;
+		next->buffer_release = NULL;
+	}
 
 	next->committed = 0;
 }
@@ -278,15 +301,124 @@ static void surface_damage_subsurfaces(struct wlr_subsurface *subsurface) {
 	}
 }
 
+static void surface_upload_handle_resource_destroy(struct wl_listener *listener,
+		void *data);
+
+/**
+ * Stop tracking the pending upload, if any. Returns the buffer resource which
+ * was pending.
+ */
+static struct wl_resource *surface_take_upload(struct wlr_surface *surface) {
+	struct wl_resource *resource = surface->upload.resource;
+	if (resource == NULL) {
+		return NULL;
+	}
+	wl_list_remove(&surface->upload.resource_destroy.link);
+	wl_list_init(&surface->upload.resource_destroy.link);
+	surface->upload.resource = NULL;
+	return resource;
+}
+
+static void surface_drop_upload(struct wlr_surface *surface) {
+	struct wl_resource *resource = surface_take_upload(surface);
+	if (resource != NULL) {
+		// The contents were superseded, the client can re-use the buffer
+		wl_buffer_send_release(resource);
+	}
+	pixman_region32_clear(&surface->upload.damage);
+}
+
+static void surface_flush_upload(struct wlr_surface *surface) {
+	struct wl_resource *resource = surface_take_upload(surface);
+	if (resource == NULL) {
+		return;
+	}
+
+	struct wlr_buffer *updated_buffer = wlr_buffer_apply_damage(
+		surface->buffer, resource, &surface->upload.damage);
+	pixman_region32_clear(&surface->upload.damage);
+	if (updated_buffer != NULL) {
+		surface->buffer = updated_buffer;
+		return;
+	}
+
+	// The texture can't be updated in place anymore, upload it all
+	struct wlr_buffer *buffer = wlr_buffer_create(surface->renderer, resource);
+	if (buffer == NULL) {
+		wlr_log(WLR_ERROR, "Failed to upload buffer");
+		return;
+	}
+	wlr_buffer_unref(surface->buffer);
+	surface->buffer = buffer;
+}
+
+static void surface_upload_handle_resource_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_surface *surface =
+		wl_container_of(listener, surface, upload.resource_destroy);
+	// The storage is still valid while the wl_buffer is being destroyed
+	surface_flush_upload(surface);
+}
+
+/**
+ * Check whether the wl_shm buffer can later be uploaded into the texture
+ * of the surface's current buffer. The renderer is not touched.
+ */
+static bool surface_can_defer_upload(struct wlr_surface *surface,
+		struct wl_resource *resource) {
+	if (surface->buffer == NULL || !surface->buffer->released ||
+			surface->buffer->resource == NULL) {
+		return false;
+	}
+
+	struct wl_shm_buffer *shm_buf = wl_shm_buffer_get(resource);
+	struct wl_shm_buffer *old_shm_buf =
+		wl_shm_buffer_get(surface->buffer->resource);
+	if (shm_buf == NULL || old_shm_buf == NULL) {
+		return false;
+	}
+	if (wl_shm_buffer_get_format(shm_buf) !=
+			wl_shm_buffer_get_format(old_shm_buf)) {
+		return false;
+	}
+
+	int texture_width, texture_height;
+	wlr_texture_get_size(surface->buffer->texture,
+		&texture_width, &texture_height);
+	return wl_shm_buffer_get_width(shm_buf) == texture_width &&
+		wl_shm_buffer_get_height(shm_buf) == texture_height;
+}
+
 static void surface_apply_damage(struct wlr_surface *surface) {
 	struct wl_resource *resource = surface->current.buffer_resource;
 	if (resource == NULL) {
 		// NULL commit
+		surface_drop_upload(surface);
 		wlr_buffer_unref(surface->buffer);
 		surface->buffer = NULL;
 		return;
 	}
 
+	if (surface_can_defer_upload(surface, resource)) {
+		// Keep the previously committed buffer around until the texture is
+		// needed. Only the latest buffer needs to be uploaded, but the damage
+		// of all commits since the last upload needs to be.
+		if (surface->upload.resource != resource) {
+			struct wl_resource *prev = surface_take_upload(surface);
+			if (prev != NULL) {
+				wl_buffer_send_release(prev);
+			}
+			surface->upload.resource = resource;
+			wl_resource_add_destroy_listener(resource,
+				&surface->upload.resource_destroy);
+		}
+		pixman_region32_union(&surface->upload.damage,
+			&surface->upload.damage, &surface->buffer_damage);
+		return;
+	}
+
+	surface_drop_upload(surface);
+
 	if (surface->buffer != NULL && surface->buffer->released) {
 		struct wlr_buffer *updated_buffer = wlr_buffer_apply_damage(
 			surface->buffer, resource, &surface->buffer_damage);
@@ -308,14 +440,36 @@ static void surface_apply_damage(struct wlr_surface *surface) {
 	surface->buffer = buffer;
 }
 
+/**
+ * Consumes the explicit synchronization state committed along with the
+ * buffer.
+ */
+static void surface_apply_sync(struct wlr_surface *surface) {
+	if (surface->current.acquire_fence_fd >= 0) {
+		// The commit has been held back until the fence was signalled, see
+		// surface_commit
+		close(surface->current.acquire_fence_fd);
+		surface->current.acquire_fence_fd = -1;
+	}
+
+	if (surface->current.buffer_release != NULL) {
+		wlr_linux_buffer_release_v1_attach(surface->current.buffer_release,
+			surface->buffer);
+		surface->current.buffer_release = NULL;
+	}
+}
+
 static void surface_update_opaque_region(struct wlr_surface *surface) {
-	struct wlr_texture *texture = wlr_surface_get_texture(surface);
+	// Don't flush a deferred upload, it can't change the texture format
+	struct wlr_texture *texture =
+		surface->buffer != NULL ? surface->buffer->texture : NULL;
 	if (texture == NULL) {
 		pixman_region32_clear(&surface->opaque_region);
 		return;
 	}
 
 	if (wlr_texture_is_opaque(texture)) {
+		pixman_region32_fini(&surface->opaque_region);
 		pixman_region32_init_rect(&surface->opaque_region,
 			0, 0, surface->current.width, surface->current.height);
 		return;
@@ -332,7 +486,121 @@ static void surface_update_input_region(struct wlr_surface *surface) {
 		0, 0, surface->current.width, surface->current.height);
 }
 
+/**
+ * Invalidate the hit-testing index of the surface and all of its ancestors.
+ */
+static void surface_invalidate_hit_index(struct wlr_surface *surface) {
+	while (surface != NULL) {
+		surface_hit_index_invalidate(surface->hit_index);
+
+		if (!wlr_surface_is_subsurface(surface)) {
+			break;
+		}
+		struct wlr_subsurface *subsurface =
+			wlr_subsurface_from_wlr_surface(surface);
+		if (subsurface == NULL) {
+			break;
+		}
+		surface = subsurface->parent;
+	}
+}
+
+static inline int64_t timespec_to_msec(const struct timespec *a) {
+	return (int64_t)a->tv_sec * 1000 + a->tv_nsec / 1000000;
+}
+
+static void surface_send_frame_done(struct wlr_surface *surface,
+		int64_t msec) {
+	surface->frame_pacing.last_done_msec = msec;
+
+	struct wl_resource *resource, *tmp;
+	wl_resource_for_each_safe(resource, tmp,
+			&surface->current.frame_callback_list) {
+		wl_callback_send_done(resource, msec);
+		wl_resource_destroy(resource);
+	}
+}
+
+static bool surface_is_throttled(struct wlr_surface *surface) {
+	return surface->frame_pacing.occluded_interval > 0 &&
+		wl_list_empty(&surface->frame_pacing.visible_outputs);
+}
+
+static int surface_handle_frame_timer(void *data) {
+	struct wlr_surface *surface = data;
+	if (!surface_is_throttled(surface)) {
+		return 0;
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	surface_send_frame_done(surface, timespec_to_msec(&now));
+	return 0;
+}
+
+/**
+ * Arm the frame timer if the surface is throttled and waits for a frame done
+ * event, disarm it otherwise.
+ */
+static void surface_update_frame_timer(struct wlr_surface *surface) {
+	if (!surface_is_throttled(surface) ||
+			wl_list_empty(&surface->current.frame_callback_list)) {
+		if (surface->frame_pacing.timer != NULL) {
+			wl_event_source_timer_update(surface->frame_pacing.timer, 0);
+		}
+		return;
+	}
+
+	if (surface->frame_pacing.timer == NULL) {
+		struct wl_client *client = wl_resource_get_client(surface->resource);
+		struct wl_event_loop *loop =
+			wl_display_get_event_loop(wl_client_get_display(client));
+		surface->frame_pacing.timer = wl_event_loop_add_timer(loop,
+			surface_handle_frame_timer, surface);
+		if (surface->frame_pacing.timer == NULL) {
+			wlr_log(WLR_ERROR, "Failed to create frame timer");
+			return;
+		}
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	int64_t delay = surface->frame_pacing.last_done_msec +
+		surface->frame_pacing.occluded_interval - timespec_to_msec(&now);
+	if (delay < 1) {
+		// 0 would disarm the timer
+		delay = 1;
+	}
+	wl_event_source_timer_update(surface->frame_pacing.timer, delay);
+}
+
+struct wlr_surface_visible_output {
+	struct wlr_surface *surface;
+	struct wlr_output *output;
+	struct wl_list link; // wlr_surface::frame_pacing.visible_outputs
+
+	struct wl_listener output_destroy;
+};
+
+static void visible_output_destroy(
+		struct wlr_surface_visible_output *visible_output) {
+	wl_list_remove(&visible_output->output_destroy.link);
+	wl_list_remove(&visible_output->link);
+	free(visible_output);
+}
+
+static void visible_output_handle_output_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_surface_visible_output *visible_output =
+		wl_container_of(listener, visible_output, output_destroy);
+	struct wlr_surface *surface = visible_output->surface;
+	visible_output_destroy(visible_output);
+	surface_update_frame_timer(surface);
+}
+
 static void surface_commit_pending(struct wlr_surface *surface) {
+	trace_point(WLR_TRACE_SURFACE_COMMIT,
+		wl_resource_get_id(surface->resource));
 	surface_state_finalize(surface, &surface->pending);
 
 	if (surface->role && surface->role->precommit) {
@@ -340,6 +608,8 @@ static void surface_commit_pending(struct wlr_surface *surface) {
 	}
 
 	bool invalid_buffer = surface->pending.committed & WLR_SURFACE_STATE_BUFFER;
+	bool invalid_hit_index =
+		surface->pending.committed & WLR_SURFACE_STATE_INPUT_REGION;
 
 	surface->sx += surface->pending.dx;
 	surface->sy += surface->pending.dy;
@@ -352,9 +622,15 @@ static void surface_commit_pending(struct wlr_surface *surface) {
 	if (invalid_buffer) {
 		surface_apply_damage(surface);
 	}
+	surface_apply_sync(surface);
 	surface_update_opaque_region(surface);
 	surface_update_input_region(surface);
 
+	if (surface->current.width != surface->previous.width ||
+			surface->current.height != surface->previous.height) {
+		invalid_hit_index = true;
+	}
+
 	// commit subsurface order
 	struct wlr_subsurface *subsurface;
 	wl_list_for_each_reverse(subsurface, &surface->subsurface_pending_list,
@@ -365,9 +641,18 @@ static void surface_commit_pending(struct wlr_surface *surface) {
 		if (subsurface->reordered) {
 			// TODO: damage all the subsurfaces
 			surface_damage_subsurfaces(subsurface);
+			invalid_hit_index = true;
 		}
 	}
 
+	if (invalid_hit_index) {
+		surface_invalidate_hit_index(surface);
+	}
+
+	if (surface_is_throttled(surface)) {
+		surface_update_frame_timer(surface);
+	}
+
 	if (surface->role && surface->role->commit) {
 		surface->role->commit(surface);
 	}
@@ -394,17 +679,52 @@ static bool subsurface_is_synchronized(struct wlr_subsurface *subsurface) {
 	return false;
 }
 
+static struct wlr_subsurface *subsurface_get_parent(
+		struct wlr_subsurface *subsurface) {
+	if (subsurface->parent == NULL ||
+			!wlr_surface_is_subsurface(subsurface->parent)) {
+		return NULL;
+	}
+	return wlr_subsurface_from_wlr_surface(subsurface->parent);
+}
+
+/**
+ * Adds `delta` to the cache count of the subsurface and of all its ancestors.
+ */
+static void subsurface_add_cache_count(struct wlr_subsurface *subsurface,
+		int delta) {
+	while (subsurface != NULL) {
+		subsurface->subtree_cache_count += delta;
+		assert(subsurface->subtree_cache_count >= 0);
+		subsurface = subsurface_get_parent(subsurface);
+	}
+}
+
+static void subsurface_set_has_cache(struct wlr_subsurface *subsurface,
+		bool has_cache) {
+	if (subsurface->has_cache == has_cache) {
+		return;
+	}
+	subsurface->has_cache = has_cache;
+	subsurface_add_cache_count(subsurface, has_cache ? 1 : -1);
+}
+
 /**
  * Recursive function to commit the effectively synchronized children.
  */
 static void subsurface_parent_commit(struct wlr_subsurface *subsurface,
 		bool synchronized) {
+	if (subsurface->subtree_cache_count == 0) {
+		// Nothing to apply in this subtree, don't walk it
+		return;
+	}
+
 	struct wlr_surface *surface = subsurface->surface;
 	if (synchronized || subsurface->synchronized) {
 		if (subsurface->has_cache) {
 			surface_state_move(&surface->pending, &subsurface->cached);
 			surface_commit_pending(surface);
-			subsurface->has_cache = false;
+			subsurface_set_has_cache(subsurface, false);
 			subsurface->cached.committed = 0;
 		}
 
@@ -420,22 +740,22 @@ static void subsurface_commit(struct wlr_subsurface *subsurface) {
 
 	if (subsurface_is_synchronized(subsurface)) {
 		surface_state_move(&subsurface->cached, &surface->pending);
-		subsurface->has_cache = true;
+		subsurface_set_has_cache(subsurface, true);
 	} else {
 		if (subsurface->has_cache) {
 			surface_state_move(&surface->pending, &subsurface->cached);
 			surface_commit_pending(surface);
-			subsurface->has_cache = false;
+			subsurface_set_has_cache(subsurface, false);
 		} else {
 			surface_commit_pending(surface);
 		}
 	}
 }
 
-static void surface_commit(struct wl_client *client,
-		struct wl_resource *resource) {
-	struct wlr_surface *surface = wlr_surface_from_resource(resource);
-
+/**
+ * Applies the pending state committed by the client.
+ */
+static void surface_commit_client_state(struct wlr_surface *surface) {
 	struct wlr_subsurface *subsurface = wlr_surface_is_subsurface(surface) ?
 		wlr_subsurface_from_wlr_surface(surface) : NULL;
 	if (subsurface != NULL) {
@@ -449,6 +769,86 @@ static void surface_commit(struct wl_client *client,
 	}
 }
 
+static void surface_state_init(struct wlr_surface_state *state);
+static void surface_state_finish(struct wlr_surface_state *state);
+
+static bool fence_is_signalled(int fence_fd) {
+	// sync_file FDs become readable once the fence is signalled
+	struct pollfd pollfd = { .fd = fence_fd, .events = POLLIN };
+	return poll(&pollfd, 1, 0) != 0;
+}
+
+static int surface_handle_fence(int fd, uint32_t mask, void *data) {
+	struct wlr_surface *surface = data;
+
+	wl_event_source_remove(surface->fence_source);
+	surface->fence_source = NULL;
+
+	// The client may have started to build its next state already, set it
+	// aside while applying the held back one
+	struct wlr_surface_state next;
+	surface_state_init(&next);
+	surface_state_move(&next, &surface->pending);
+	surface_state_move(&surface->pending, &surface->fenced);
+
+	surface_commit_client_state(surface);
+
+	surface_state_move(&surface->pending, &next);
+	surface_state_finish(&next);
+	return 0;
+}
+
+/**
+ * Holds back the pending state until its acquire fence is signalled, so that
+ * the renderer never samples a buffer the client is still writing to and the
+ * compositor never blocks on it. Commits made in the meantime are merged into
+ * the held back state to preserve their order. Returns false if the pending
+ * state can be applied right away.
+ */
+static bool surface_hold_back_commit(struct wlr_surface *surface) {
+	int fence_fd = surface->pending.acquire_fence_fd;
+	if (surface->fence_source == NULL &&
+			(fence_fd < 0 || fence_is_signalled(fence_fd))) {
+		return false;
+	}
+
+	if (fence_fd >= 0 && surface->fence_source != NULL) {
+		// The new buffer supersedes the held back one, wait for its fence
+		// instead
+		wl_event_source_remove(surface->fence_source);
+		surface->fence_source = NULL;
+	}
+
+	surface_state_move(&surface->fenced, &surface->pending);
+
+	if (surface->fence_source == NULL) {
+		struct wl_client *client = wl_resource_get_client(surface->resource);
+		struct wl_event_loop *loop =
+			wl_display_get_event_loop(wl_client_get_display(client));
+		surface->fence_source = wl_event_loop_add_fd(loop,
+			surface->fenced.acquire_fence_fd, WL_EVENT_READABLE,
+			surface_handle_fence, surface);
+		if (surface->fence_source == NULL) {
+			wlr_log(WLR_ERROR, "Failed to wait for acquire fence");
+			surface_state_move(&surface->pending, &surface->fenced);
+			return false;
+		}
+	}
+	return true;
+}
+
+static void surface_commit(struct wl_client *client,
+		struct wl_resource *resource) {
+	struct wlr_surface *surface = wlr_surface_from_resource(resource);
+
+	wlr_signal_emit_safe(&surface->events.client_commit, surface);
+
+	if (surface_hold_back_commit(surface)) {
+		return;
+	}
+	surface_commit_client_state(surface);
+}
+
 static void surface_set_buffer_transform(struct wl_client *client,
 		struct wl_resource *resource, int32_t transform) {
 	if (transform < WL_OUTPUT_TRANSFORM_NORMAL ||
@@ -510,6 +910,7 @@ struct wlr_surface *wlr_surface_from_resource(struct wl_resource *resource) {
 static void surface_state_init(struct wlr_surface_state *state) {
 	state->scale = 1;
 	state->transform = WL_OUTPUT_TRANSFORM_NORMAL;
+	state->acquire_fence_fd = -1;
 
 	wl_list_init(&state->frame_callback_list);
 
@@ -532,6 +933,11 @@ static void surface_state_finish(struct wlr_surface_state *state) {
 	pixman_region32_fini(&state->buffer_damage);
 	pixman_region32_fini(&state->opaque);
 	pixman_region32_fini(&state->input);
+
+	if (state->acquire_fence_fd >= 0) {
+		close(state->acquire_fence_fd);
+	}
+	wlr_linux_buffer_release_v1_destroy(state->buffer_release);
 }
 
 static void subsurface_unmap(struct wlr_subsurface *subsurface);
@@ -549,6 +955,9 @@ static void subsurface_destroy(struct wlr_subsurface *subsurface) {
 	surface_state_finish(&subsurface->cached);
 
 	if (subsurface->parent) {
+		surface_invalidate_hit_index(subsurface->parent);
+		subsurface_add_cache_count(subsurface_get_parent(subsurface),
+			-subsurface->subtree_cache_count);
 		wl_list_remove(&subsurface->parent_link);
 		wl_list_remove(&subsurface->parent_pending_link);
 		wl_list_remove(&subsurface->parent_destroy.link);
@@ -569,13 +978,28 @@ static void surface_handle_resource_destroy(struct wl_resource *resource) {
 	wl_list_remove(wl_resource_get_link(surface->resource));
 
 	wl_list_remove(&surface->renderer_destroy.link);
+	if (surface->fence_source != NULL) {
+		wl_event_source_remove(surface->fence_source);
+	}
+	surface_state_finish(&surface->fenced);
 	surface_state_finish(&surface->pending);
 	surface_state_finish(&surface->current);
 	surface_state_finish(&surface->previous);
 	pixman_region32_fini(&surface->buffer_damage);
 	pixman_region32_fini(&surface->opaque_region);
 	pixman_region32_fini(&surface->input_region);
+	surface_drop_upload(surface);
+	pixman_region32_fini(&surface->upload.damage);
 	wlr_buffer_unref(surface->buffer);
+	surface_hit_index_destroy(surface->hit_index);
+	struct wlr_surface_visible_output *visible_output, *tmp;
+	wl_list_for_each_safe(visible_output, tmp,
+			&surface->frame_pacing.visible_outputs, link) {
+		visible_output_destroy(visible_output);
+	}
+	if (surface->frame_pacing.timer != NULL) {
+		wl_event_source_remove(surface->frame_pacing.timer);
+	}
 	free(surface);
 }
 
@@ -613,15 +1037,22 @@ struct wlr_surface *wlr_surface_create(struct wl_client *client,
 	surface_state_init(&surface->current);
 	surface_state_init(&surface->pending);
 	surface_state_init(&surface->previous);
+	surface_state_init(&surface->fenced);
 
+	wl_signal_init(&surface->events.client_commit);
 	wl_signal_init(&surface->events.commit);
 	wl_signal_init(&surface->events.destroy);
 	wl_signal_init(&surface->events.new_subsurface);
 	wl_list_init(&surface->subsurfaces);
 	wl_list_init(&surface->subsurface_pending_list);
+	wl_list_init(&surface->frame_pacing.visible_outputs);
 	pixman_region32_init(&surface->buffer_damage);
 	pixman_region32_init(&surface->opaque_region);
 	pixman_region32_init(&surface->input_region);
+	pixman_region32_init(&surface->upload.damage);
+	wl_list_init(&surface->upload.resource_destroy.link);
+	surface->upload.resource_destroy.notify =
+		surface_upload_handle_resource_destroy;
 
 	wl_signal_add(&renderer->events.destroy, &surface->renderer_destroy);
 	surface->renderer_destroy.notify = surface_handle_renderer_destroy;
@@ -637,6 +1068,7 @@ struct wlr_surface *wlr_surface_create(struct wl_client *client,
 }
 
 struct wlr_texture *wlr_surface_get_texture(struct wlr_surface *surface) {
+	surface_flush_upload(surface);
 	if (surface->buffer == NULL) {
 		return NULL;
 	}
@@ -644,7 +1076,7 @@ struct wlr_texture *wlr_surface_get_texture(struct wlr_surface *surface) {
 }
 
 bool wlr_surface_has_buffer(struct wlr_surface *surface) {
-	return wlr_surface_get_texture(surface) != NULL;
+	return surface->buffer != NULL && surface->buffer->texture != NULL;
 }
 
 bool wlr_surface_set_role(struct wlr_surface *surface,
@@ -868,6 +1300,7 @@ static void subsurface_role_commit(struct wlr_surface *surface) {
 
 		subsurface->current.x = subsurface->pending.x;
 		subsurface->current.y = subsurface->pending.y;
+		surface_invalidate_hit_index(subsurface->parent);
 
 		if ((surface->current.transform & WL_OUTPUT_TRANSFORM_90) != 0) {
 			int tmp = dx;
@@ -912,6 +1345,9 @@ static void subsurface_handle_parent_destroy(struct wl_listener *listener,
 	struct wlr_subsurface *subsurface =
 		wl_container_of(listener, subsurface, parent_destroy);
 	subsurface_unmap(subsurface);
+	surface_invalidate_hit_index(subsurface->parent);
+	subsurface_add_cache_count(subsurface_get_parent(subsurface),
+		-subsurface->subtree_cache_count);
 	wl_list_remove(&subsurface->parent_link);
 	wl_list_remove(&subsurface->parent_pending_link);
 	wl_list_remove(&subsurface->parent_destroy.link);
@@ -967,9 +1403,22 @@ struct wlr_subsurface *wlr_subsurface_create(struct wlr_surface *surface,
 	wl_list_insert(parent->subsurfaces.prev, &subsurface->parent_link);
 	wl_list_insert(parent->subsurface_pending_list.prev,
 		&subsurface->parent_pending_link);
+	surface_invalidate_hit_index(parent);
 
 	surface->role_data = subsurface;
 
+	// The surface may have had a wl_subsurface before, destroyed while some
+	// of its children still had a cached state. Account for them, otherwise
+	// subsurface_parent_commit would never reach them and their cached state
+	// would be stuck, and the count would underflow once they apply it. The
+	// children's counts already include their own cached state.
+	int cache_count = 0;
+	struct wlr_subsurface *child;
+	wl_list_for_each(child, &surface->subsurfaces, parent_link) {
+		cache_count += child->subtree_cache_count;
+	}
+	subsurface_add_cache_count(subsurface, cache_count);
+
 	struct wl_list *resource_link = wl_resource_get_link(subsurface->resource);
 	if (resource_list != NULL) {
 		wl_list_insert(resource_list, resource_link);
@@ -1002,13 +1451,13 @@ bool wlr_surface_point_accepts_input(struct wlr_surface *surface,
 		pixman_region32_contains_point(&surface->current.input, floor(sx), floor(sy), NULL);
 }
 
-struct wlr_surface *wlr_surface_surface_at(struct wlr_surface *surface,
+static struct wlr_surface *surface_surface_at(struct wlr_surface *surface,
 		double sx, double sy, double *sub_x, double *sub_y) {
 	struct wlr_subsurface *subsurface;
 	wl_list_for_each_reverse(subsurface, &surface->subsurfaces, parent_link) {
 		double _sub_x = subsurface->current.x;
 		double _sub_y = subsurface->current.y;
-		struct wlr_surface *sub = wlr_surface_surface_at(subsurface->surface,
+		struct wlr_surface *sub = surface_surface_at(subsurface->surface,
 			sx - _sub_x, sy - _sub_y, sub_x, sub_y);
 		if (sub != NULL) {
 			return sub;
@@ -1024,6 +1473,33 @@ struct wlr_surface *wlr_surface_surface_at(struct wlr_surface *surface,
 	return NULL;
 }
 
+void wlr_surface_enable_hit_index(struct wlr_surface *surface, bool enabled) {
+	if (!enabled) {
+		surface_hit_index_destroy(surface->hit_index);
+		surface->hit_index = NULL;
+	} else if (surface->hit_index == NULL) {
+		surface->hit_index = surface_hit_index_create();
+		if (surface->hit_index == NULL) {
+			wlr_log(WLR_ERROR, "Failed to create surface hit index");
+		}
+	}
+}
+
+struct wlr_surface *wlr_surface_surface_at(struct wlr_surface *surface,
+		double sx, double sy, double *sub_x, double *sub_y) {
+	if (surface->hit_index != NULL) {
+		bool ok;
+		struct wlr_surface *found = surface_hit_index_surface_at(
+			surface->hit_index, surface, sx, sy, sub_x, sub_y, &ok);
+		if (ok) {
+			return found;
+		}
+	}
+
+	// No index or the tree is too small for it, walk the surface tree
+	return surface_surface_at(surface, sx, sy, sub_x, sub_y);
+}
+
 void wlr_surface_send_enter(struct wlr_surface *surface,
 		struct wlr_output *output) {
 	struct wl_client *client = wl_resource_get_client(surface->resource);
@@ -1046,18 +1522,61 @@ void wlr_surface_send_leave(struct wlr_surface *surface,
 	}
 }
 
-static inline int64_t timespec_to_msec(const struct timespec *a) {
-	return (int64_t)a->tv_sec * 1000 + a->tv_nsec / 1000000;
-}
-
 void wlr_surface_send_frame_done(struct wlr_surface *surface,
 		const struct timespec *when) {
-	struct wl_resource *resource, *tmp;
-	wl_resource_for_each_safe(resource, tmp,
-			&surface->current.frame_callback_list) {
-		wl_callback_send_done(resource, timespec_to_msec(when));
-		wl_resource_destroy(resource);
+	int64_t msec = timespec_to_msec(when);
+	if (surface_is_throttled(surface) &&
+			msec - surface->frame_pacing.last_done_msec <
+			surface->frame_pacing.occluded_interval) {
+		surface_update_frame_timer(surface);
+		return;
+	}
+	surface_send_frame_done(surface, msec);
+}
+
+void wlr_surface_set_output_visible(struct wlr_surface *surface,
+		struct wlr_output *output, bool visible) {
+	struct wlr_surface_visible_output *visible_output, *found = NULL;
+	wl_list_for_each(visible_output, &surface->frame_pacing.visible_outputs,
+			link) {
+		if (visible_output->output == output) {
+			found = visible_output;
+			break;
+		}
+	}
+
+	if (visible && found == NULL) {
+		visible_output = calloc(1, sizeof(struct wlr_surface_visible_output));
+		if (visible_output == NULL) {
+			wlr_log(WLR_ERROR, "Allocation failed");
+			return;
+		}
+		visible_output->surface = surface;
+		visible_output->output = output;
+		wl_signal_add(&output->events.destroy,
+			&visible_output->output_destroy);
+		visible_output->output_destroy.notify =
+			visible_output_handle_output_destroy;
+		wl_list_insert(&surface->frame_pacing.visible_outputs,
+			&visible_output->link);
+	} else if (!visible && found != NULL) {
+		visible_output_destroy(found);
+	} else {
+		return;
+	}
+
+	surface_update_frame_timer(surface);
+}
+
+void wlr_surface_set_occluded_frame_rate(struct wlr_surface *surface,
+		int rate) {
+	assert(rate >= 0);
+	if (rate == 0) {
+		surface->frame_pacing.occluded_interval = 0;
+	} else {
+		surface->frame_pacing.occluded_interval = rate < 1000 ? 1000 / rate : 1;
 	}
+	surface_update_frame_timer(surface);
 }
 
 static void surface_for_each_surface(struct wlr_surface *surface, int x, int y,
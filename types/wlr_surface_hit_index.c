@@ -0,0 +1,266 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <wlr/types/wlr_surface.h>
+#include "types/wlr_surface.h"
+
+#define HIT_INDEX_LEAF_SIZE 4
+// Below this number of surfaces, walking the tree is cheaper than maintaining
+// the index
+#define HIT_INDEX_MIN_ENTRIES 16
+#define HIT_INDEX_STACK_SIZE 64
+
+struct hit_index_entry {
+	struct wlr_surface *surface;
+	int x, y; // position of the surface in the tree
+	pixman_box32_t box; // input region extents, in tree coordinates
+	size_t prio; // position in the stacking order, 0 is the topmost surface
+};
+
+struct hit_index_node {
+	pixman_box32_t box;
+	size_t min_prio;
+	size_t first, count; // entries covered by this node
+	size_t left, right; // children, unless the node is a leaf
+};
+
+struct wlr_surface_hit_index {
+	bool dirty;
+	bool small; // the tree is too small to be indexed
+
+	struct hit_index_entry *entries;
+	size_t entries_len, entries_cap;
+
+	struct hit_index_node *nodes;
+	size_t nodes_len, nodes_cap;
+};
+
+struct wlr_surface_hit_index *surface_hit_index_create(void) {
+	struct wlr_surface_hit_index *index =
+		calloc(1, sizeof(struct wlr_surface_hit_index));
+	if (index == NULL) {
+		return NULL;
+	}
+	index->dirty = true;
+	return index;
+}
+
+void surface_hit_index_destroy(struct wlr_surface_hit_index *index) {
+	if (index == NULL) {
+		return;
+	}
+	free(index->entries);
+	free(index->nodes);
+	free(index);
+}
+
+void surface_hit_index_invalidate(struct wlr_surface_hit_index *index) {
+	if (index == NULL) {
+		return;
+	}
+	index->dirty = true;
+}
+
+static bool hit_index_add_entry(struct wlr_surface_hit_index *index,
+		struct wlr_surface *surface, int x, int y) {
+	if (index->entries_len == index->entries_cap) {
+		size_t cap = index->entries_cap == 0 ? 8 : 2 * index->entries_cap;
+		struct hit_index_entry *entries =
+			realloc(index->entries, cap * sizeof(struct hit_index_entry));
+		if (entries == NULL) {
+			return false;
+		}
+		index->entries = entries;
+		index->entries_cap = cap;
+	}
+
+	pixman_box32_t *extents = pixman_region32_extents(&surface->input_region);
+	struct hit_index_entry *entry = &index->entries[index->entries_len];
+	entry->surface = surface;
+	entry->x = x;
+	entry->y = y;
+	entry->box.x1 = x + extents->x1;
+	entry->box.y1 = y + extents->y1;
+	entry->box.x2 = x + extents->x2;
+	entry->box.y2 = y + extents->y2;
+	entry->prio = index->entries_len;
+	index->entries_len++;
+	return true;
+}
+
+/**
+ * Adds the surface tree to the index, in the same order as a depth-first
+ * search would visit it.
+ */
+static bool hit_index_add_tree(struct wlr_surface_hit_index *index,
+		struct wlr_surface *surface, int x, int y) {
+	struct wlr_subsurface *subsurface;
+	wl_list_for_each_reverse(subsurface, &surface->subsurfaces, parent_link) {
+		if (!hit_index_add_tree(index, subsurface->surface,
+				x + subsurface->current.x, y + subsurface->current.y)) {
+			return false;
+		}
+	}
+
+	if (!pixman_region32_not_empty(&surface->input_region)) {
+		return true;
+	}
+	return hit_index_add_entry(index, surface, x, y);
+}
+
+static int entry_compare_x(const void *_a, const void *_b) {
+	const struct hit_index_entry *a = _a, *b = _b;
+	int32_t ca = a->box.x1 + a->box.x2, cb = b->box.x1 + b->box.x2;
+	return (ca > cb) - (ca < cb);
+}
+
+static int entry_compare_y(const void *_a, const void *_b) {
+	const struct hit_index_entry *a = _a, *b = _b;
+	int32_t ca = a->box.y1 + a->box.y2, cb = b->box.y1 + b->box.y2;
+	return (ca > cb) - (ca < cb);
+}
+
+static size_t hit_index_build_node(struct wlr_surface_hit_index *index,
+		size_t first, size_t count) {
+	assert(index->nodes_len < index->nodes_cap);
+	size_t i = index->nodes_len++;
+
+	struct hit_index_node *node = &index->nodes[i];
+	node->first = first;
+	node->count = count;
+	node->box = index->entries[first].box;
+	node->min_prio = index->entries[first].prio;
+	for (size_t j = first + 1; j < first + count; j++) {
+		struct hit_index_entry *entry = &index->entries[j];
+		if (entry->box.x1 < node->box.x1) {
+			node->box.x1 = entry->box.x1;
+		}
+		if (entry->box.y1 < node->box.y1) {
+			node->box.y1 = entry->box.y1;
+		}
+		if (entry->box.x2 > node->box.x2) {
+			node->box.x2 = entry->box.x2;
+		}
+		if (entry->box.y2 > node->box.y2) {
+			node->box.y2 = entry->box.y2;
+		}
+		if (entry->prio < node->min_prio) {
+			node->min_prio = entry->prio;
+		}
+	}
+
+	if (count <= HIT_INDEX_LEAF_SIZE) {
+		return i;
+	}
+
+	// Split along the longest axis, at the median
+	bool split_x = node->box.x2 - node->box.x1 >= node->box.y2 - node->box.y1;
+	qsort(&index->entries[first], count, sizeof(struct hit_index_entry),
+		split_x ? entry_compare_x : entry_compare_y);
+
+	size_t half = count / 2;
+	size_t left = hit_index_build_node(index, first, half);
+	size_t right = hit_index_build_node(index, first + half, count - half);
+	index->nodes[i].left = left;
+	index->nodes[i].right = right;
+	return i;
+}
+
+static bool hit_index_rebuild(struct wlr_surface_hit_index *index,
+		struct wlr_surface *surface) {
+	index->entries_len = 0;
+	index->nodes_len = 0;
+
+	if (!hit_index_add_tree(index, surface, 0, 0)) {
+		return false;
+	}
+	index->small = index->entries_len < HIT_INDEX_MIN_ENTRIES;
+	if (index->small) {
+		index->dirty = false;
+		return true;
+	}
+
+	// Every split produces two non-empty halves, so there are less than twice
+	// as many nodes as entries
+	size_t nodes_cap = 2 * index->entries_len;
+	if (index->nodes_cap < nodes_cap) {
+		struct hit_index_node *nodes =
+			realloc(index->nodes, nodes_cap * sizeof(struct hit_index_node));
+		if (nodes == NULL) {
+			return false;
+		}
+		index->nodes = nodes;
+		index->nodes_cap = nodes_cap;
+	}
+
+	hit_index_build_node(index, 0, index->entries_len);
+	index->dirty = false;
+	return true;
+}
+
+static bool box_contains_point(const pixman_box32_t *box, double x, double y) {
+	return x >= box->x1 && x < box->x2 && y >= box->y1 && y < box->y2;
+}
+
+struct wlr_surface *surface_hit_index_surface_at(
+		struct wlr_surface_hit_index *index, struct wlr_surface *surface,
+		double sx, double sy, double *sub_x, double *sub_y, bool *ok) {
+	*ok = true;
+	if (index->dirty && !hit_index_rebuild(index, surface)) {
+		*ok = false;
+		return NULL;
+	}
+	if (index->small) {
+		*ok = false;
+		return NULL;
+	}
+
+	// Depth-first traversal, skipping subtrees which only contain surfaces
+	// below the best match found so far
+	struct hit_index_entry *best = NULL;
+	size_t stack[HIT_INDEX_STACK_SIZE];
+	size_t stack_len = 0;
+	stack[stack_len++] = 0;
+	while (stack_len > 0) {
+		struct hit_index_node *node = &index->nodes[stack[--stack_len]];
+		if (best != NULL && node->min_prio >= best->prio) {
+			continue;
+		}
+		if (!box_contains_point(&node->box, sx, sy)) {
+			continue;
+		}
+
+		if (node->count <= HIT_INDEX_LEAF_SIZE) {
+			for (size_t i = node->first; i < node->first + node->count; i++) {
+				struct hit_index_entry *entry = &index->entries[i];
+				if (best != NULL && entry->prio >= best->prio) {
+					continue;
+				}
+				if (box_contains_point(&entry->box, sx, sy) &&
+						wlr_surface_point_accepts_input(entry->surface,
+							sx - entry->x, sy - entry->y)) {
+					best = entry;
+				}
+			}
+			continue;
+		}
+
+		// Visit the child containing the topmost surface first
+		assert(stack_len + 2 <= HIT_INDEX_STACK_SIZE);
+		struct hit_index_node *left = &index->nodes[node->left];
+		struct hit_index_node *right = &index->nodes[node->right];
+		if (left->min_prio < right->min_prio) {
+			stack[stack_len++] = node->right;
+			stack[stack_len++] = node->left;
+		} else {
+			stack[stack_len++] = node->left;
+			stack[stack_len++] = node->right;
+		}
+	}
+
+	if (best == NULL) {
+		return NULL;
+	}
+	*sub_x = sx - best->x;
+	*sub_y = sy - best->y;
+	return best->surface;
+}
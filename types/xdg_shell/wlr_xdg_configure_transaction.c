@@ -0,0 +1,212 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <wlr/util/log.h>
+#include "types/wlr_xdg_shell.h"
+#include "util/signal.h"
+
+static void transaction_finish(
+		struct wlr_xdg_configure_transaction *transaction) {
+	wlr_signal_emit_safe(&transaction->events.ready, transaction);
+	wlr_xdg_configure_transaction_destroy(transaction);
+}
+
+static void entry_stop_listening(
+		struct wlr_xdg_configure_transaction_entry *entry) {
+	wl_list_remove(&entry->surface_destroy.link);
+	wl_list_remove(&entry->surface_unmap.link);
+	wl_list_remove(&entry->surface_ack_configure.link);
+	wl_list_remove(&entry->surface_commit.link);
+	wl_list_init(&entry->surface_destroy.link);
+	wl_list_init(&entry->surface_unmap.link);
+	wl_list_init(&entry->surface_ack_configure.link);
+	wl_list_init(&entry->surface_commit.link);
+}
+
+static void entry_set_ready(struct wlr_xdg_configure_transaction_entry *entry) {
+	if (entry->ready) {
+		return;
+	}
+	entry->ready = true;
+	entry_stop_listening(entry);
+
+	struct wlr_xdg_configure_transaction *transaction = entry->transaction;
+	assert(transaction->pending > 0);
+	transaction->pending--;
+	if (transaction->committed && transaction->pending == 0) {
+		transaction_finish(transaction);
+	}
+}
+
+static void entry_handle_surface_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_xdg_configure_transaction_entry *entry =
+		wl_container_of(listener, entry, surface_destroy);
+	entry->surface = NULL;
+	entry_set_ready(entry);
+}
+
+static void entry_handle_surface_unmap(struct wl_listener *listener,
+		void *data) {
+	struct wlr_xdg_configure_transaction_entry *entry =
+		wl_container_of(listener, entry, surface_unmap);
+	// An unmapped surface won't be displayed, don't hold the others back
+	entry_set_ready(entry);
+}
+
+static void entry_handle_surface_ack_configure(struct wl_listener *listener,
+		void *data) {
+	struct wlr_xdg_configure_transaction_entry *entry =
+		wl_container_of(listener, entry, surface_ack_configure);
+	struct wlr_xdg_surface_configure *configure = data;
+	// Acking a later configure implicitly acks ours, serials may wrap around
+	if (entry->serial != 0 &&
+			(int32_t)(configure->serial - entry->serial) >= 0) {
+		entry->acked = true;
+	}
+}
+
+static void entry_handle_surface_commit(struct wl_listener *listener,
+		void *data) {
+	struct wlr_xdg_configure_transaction_entry *entry =
+		wl_container_of(listener, entry, surface_commit);
+	if (entry->acked) {
+		entry_set_ready(entry);
+	}
+}
+
+static void entry_destroy(struct wlr_xdg_configure_transaction_entry *entry) {
+	wl_list_remove(&entry->surface_destroy.link);
+	wl_list_remove(&entry->surface_unmap.link);
+	wl_list_remove(&entry->surface_ack_configure.link);
+	wl_list_remove(&entry->surface_commit.link);
+	wl_list_remove(&entry->link);
+	free(entry);
+}
+
+static int transaction_handle_timeout(void *data) {
+	struct wlr_xdg_configure_transaction *transaction = data;
+	wlr_log(WLR_DEBUG, "Configure transaction timed out with %zu "
+		"toplevel(s) pending", transaction->pending);
+	transaction->timed_out = true;
+	transaction_finish(transaction);
+	return 0;
+}
+
+struct wlr_xdg_configure_transaction *wlr_xdg_configure_transaction_create(
+		struct wl_display *display) {
+	struct wlr_xdg_configure_transaction *transaction =
+		calloc(1, sizeof(struct wlr_xdg_configure_transaction));
+	if (transaction == NULL) {
+		return NULL;
+	}
+	transaction->event_loop = wl_display_get_event_loop(display);
+	wl_list_init(&transaction->entries);
+	wl_signal_init(&transaction->events.ready);
+	wl_signal_init(&transaction->events.destroy);
+	return transaction;
+}
+
+struct wlr_xdg_configure_transaction_entry *
+		wlr_xdg_configure_transaction_add_size(
+		struct wlr_xdg_configure_transaction *transaction,
+		struct wlr_xdg_surface *surface, uint32_t width, uint32_t height) {
+	assert(!transaction->committed);
+	assert(surface->role == WLR_XDG_SURFACE_ROLE_TOPLEVEL);
+
+	struct wlr_xdg_configure_transaction_entry *entry;
+	wl_list_for_each(entry, &transaction->entries, link) {
+		if (entry->surface == surface) {
+			entry->width = width;
+			entry->height = height;
+			return entry;
+		}
+	}
+
+	entry = calloc(1, sizeof(struct wlr_xdg_configure_transaction_entry));
+	if (entry == NULL) {
+		return NULL;
+	}
+	entry->transaction = transaction;
+	entry->surface = surface;
+	entry->width = width;
+	entry->height = height;
+
+	wl_signal_add(&surface->events.destroy, &entry->surface_destroy);
+	entry->surface_destroy.notify = entry_handle_surface_destroy;
+	wl_signal_add(&surface->events.unmap, &entry->surface_unmap);
+	entry->surface_unmap.notify = entry_handle_surface_unmap;
+	wl_signal_add(&surface->events.ack_configure,
+		&entry->surface_ack_configure);
+	entry->surface_ack_configure.notify = entry_handle_surface_ack_configure;
+	wl_signal_add(&surface->surface->events.commit, &entry->surface_commit);
+	entry->surface_commit.notify = entry_handle_surface_commit;
+
+	wl_list_insert(transaction->entries.prev, &entry->link);
+	transaction->pending++;
+	return entry;
+}
+
+void wlr_xdg_configure_transaction_commit(
+		struct wlr_xdg_configure_transaction *transaction, uint32_t timeout_ms) {
+	assert(!transaction->committed);
+
+	// Schedule all configures first, then send them together so that the
+	// clients all get their new size in the same flush
+	struct wlr_xdg_configure_transaction_entry *entry;
+	wl_list_for_each(entry, &transaction->entries, link) {
+		if (entry->ready) {
+			continue;
+		}
+		entry->serial = wlr_xdg_toplevel_set_size(entry->surface,
+			entry->width, entry->height);
+	}
+	wl_list_for_each(entry, &transaction->entries, link) {
+		if (entry->ready) {
+			continue;
+		}
+		flush_xdg_surface_configure(entry->surface);
+	}
+
+	if (timeout_ms > 0) {
+		transaction->timer = wl_event_loop_add_timer(transaction->event_loop,
+			transaction_handle_timeout, transaction);
+		if (transaction->timer != NULL) {
+			wl_event_source_timer_update(transaction->timer, timeout_ms);
+		} else {
+			wlr_log(WLR_ERROR, "Failed to create configure transaction timer");
+		}
+	}
+
+	// Toplevels which already have the requested size, or aren't mapped, have
+	// nothing to wait for
+	struct wlr_xdg_configure_transaction_entry *tmp;
+	wl_list_for_each_safe(entry, tmp, &transaction->entries, link) {
+		if (!entry->ready &&
+				(entry->serial == 0 || !entry->surface->mapped)) {
+			entry_set_ready(entry);
+		}
+	}
+
+	transaction->committed = true;
+	if (transaction->pending == 0) {
+		transaction_finish(transaction);
+	}
+}
+
+void wlr_xdg_configure_transaction_destroy(
+		struct wlr_xdg_configure_transaction *transaction) {
+	if (transaction == NULL) {
+		return;
+	}
+	wlr_signal_emit_safe(&transaction->events.destroy, transaction);
+
+	struct wlr_xdg_configure_transaction_entry *entry, *tmp;
+	wl_list_for_each_safe(entry, tmp, &transaction->entries, link) {
+		entry_destroy(entry);
+	}
+	if (transaction->timer != NULL) {
+		wl_event_source_remove(transaction->timer);
+	}
+	free(transaction);
+}
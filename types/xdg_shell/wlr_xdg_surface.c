@@ -228,6 +228,16 @@ uint32_t wlr_xdg_surface_schedule_configure(struct wlr_xdg_surface *surface) {
 	return schedule_configure(surface, false);
 }
 
+uint32_t flush_xdg_surface_configure(struct wlr_xdg_surface *surface) {
+	if (surface->configure_idle == NULL) {
+		return 0;
+	}
+	uint32_t serial = surface->configure_next_serial;
+	wl_event_source_remove(surface->configure_idle);
+	surface_send_configure(surface);
+	return serial;
+}
+
 static void xdg_surface_handle_get_popup(struct wl_client *client,
 		struct wl_resource *resource, uint32_t id,
 		struct wl_resource *parent_resource,
@@ -0,0 +1,117 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "util/hash_map.h"
+
+#define HASH_MAP_MIN_CAP 8
+
+static uint64_t hash_key(uint64_t key) {
+	// Finalizer of MurmurHash3, spreads sequential IDs and aligned pointers
+	key ^= key >> 33;
+	key *= UINT64_C(0xff51afd7ed558ccd);
+	key ^= key >> 33;
+	key *= UINT64_C(0xc4ceb9fe1a85ec53);
+	key ^= key >> 33;
+	return key;
+}
+
+void hash_map_init(struct hash_map *map) {
+	map->entries = NULL;
+	map->len = 0;
+	map->cap = 0;
+}
+
+void hash_map_finish(struct hash_map *map) {
+	free(map->entries);
+	hash_map_init(map);
+}
+
+static size_t find_slot(const struct hash_map_entry *entries, size_t cap,
+		uint64_t key) {
+	size_t mask = cap - 1;
+	size_t i = hash_key(key) & mask;
+	while (entries[i].key != 0 && entries[i].key != key) {
+		i = (i + 1) & mask;
+	}
+	return i;
+}
+
+void *hash_map_get(const struct hash_map *map, uint64_t key) {
+	assert(key != 0);
+	if (map->len == 0) {
+		return NULL;
+	}
+	size_t i = find_slot(map->entries, map->cap, key);
+	return map->entries[i].key == key ? map->entries[i].value : NULL;
+}
+
+static bool hash_map_resize(struct hash_map *map, size_t cap) {
+	struct hash_map_entry *entries =
+		calloc(cap, sizeof(struct hash_map_entry));
+	if (entries == NULL) {
+		return false;
+	}
+	for (size_t i = 0; i < map->cap; i++) {
+		struct hash_map_entry *entry = &map->entries[i];
+		if (entry->key != 0) {
+			entries[find_slot(entries, cap, entry->key)] = *entry;
+		}
+	}
+	free(map->entries);
+	map->entries = entries;
+	map->cap = cap;
+	return true;
+}
+
+bool hash_map_set(struct hash_map *map, uint64_t key, void *value) {
+	assert(key != 0);
+	// Keep the load factor under 3/4
+	if (4 * (map->len + 1) > 3 * map->cap) {
+		size_t cap = map->cap == 0 ? HASH_MAP_MIN_CAP : 2 * map->cap;
+		if (!hash_map_resize(map, cap)) {
+			return false;
+		}
+	}
+
+	size_t i = find_slot(map->entries, map->cap, key);
+	if (map->entries[i].key == 0) {
+		map->entries[i].key = key;
+		map->len++;
+	}
+	map->entries[i].value = value;
+	return true;
+}
+
+void *hash_map_remove(struct hash_map *map, uint64_t key) {
+	assert(key != 0);
+	if (map->len == 0) {
+		return NULL;
+	}
+
+	size_t mask = map->cap - 1;
+	size_t i = find_slot(map->entries, map->cap, key);
+	if (map->entries[i].key != key) {
+		return NULL;
+	}
+	void *value = map->entries[i].value;
+	map->len--;
+
+	// Shift back the following entries of the probe sequence which would
+	// become unreachable, instead of leaving a tombstone
+	size_t j = i;
+	while (true) {
+		j = (j + 1) & mask;
+		struct hash_map_entry *entry = &map->entries[j];
+		if (entry->key == 0) {
+			break;
+		}
+		size_t home = hash_key(entry->key) & mask;
+		// Move the entry if its home slot isn't in the cyclic range (i, j]
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			map->entries[i] = *entry;
+			i = j;
+		}
+	}
+	map->entries[i].key = 0;
+	map->entries[i].value = NULL;
+	return value;
+}
@@ -5,6 +5,34 @@
 #include <wlr/types/wlr_box.h>
 #include <wlr/util/region.h>
 
+/**
+ * Number of rectangles kept on the stack when building a new region. Surface
+ * regions rarely have more than a handful of rectangles, so most region
+ * operations don't need any temporary heap allocation.
+ */
+#define REGION_STACK_RECTS 16
+
+static pixman_box32_t *region_rects_alloc(pixman_box32_t *stack_rects,
+		int nrects) {
+	if (nrects <= REGION_STACK_RECTS) {
+		return stack_rects;
+	}
+	return malloc(nrects * sizeof(pixman_box32_t));
+}
+
+/**
+ * Replaces the contents of `dst` with `rects` and frees `rects` if it was
+ * heap-allocated.
+ */
+static void region_reset_rects(pixman_region32_t *dst, pixman_box32_t *rects,
+		int nrects, pixman_box32_t *stack_rects) {
+	pixman_region32_fini(dst);
+	pixman_region32_init_rects(dst, rects, nrects);
+	if (rects != stack_rects) {
+		free(rects);
+	}
+}
+
 void wlr_region_scale(pixman_region32_t *dst, pixman_region32_t *src,
 		float scale) {
 	if (scale == 1) {
@@ -15,7 +43,8 @@ void wlr_region_scale(pixman_region32_t *dst, pixman_region32_t *src,
 	int nrects;
 	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
 
-	pixman_box32_t *dst_rects = malloc(nrects * sizeof(pixman_box32_t));
+	pixman_box32_t stack_rects[REGION_STACK_RECTS];
+	pixman_box32_t *dst_rects = region_rects_alloc(stack_rects, nrects);
 	if (dst_rects == NULL) {
 		return;
 	}
@@ -27,9 +56,7 @@ void wlr_region_scale(pixman_region32_t *dst, pixman_region32_t *src,
 		dst_rects[i].y2 = ceil(src_rects[i].y2 * scale);
 	}
 
-	pixman_region32_fini(dst);
-	pixman_region32_init_rects(dst, dst_rects, nrects);
-	free(dst_rects);
+	region_reset_rects(dst, dst_rects, nrects, stack_rects);
 }
 
 void wlr_region_transform(pixman_region32_t *dst, pixman_region32_t *src,
@@ -42,7 +69,8 @@ void wlr_region_transform(pixman_region32_t *dst, pixman_region32_t *src,
 	int nrects;
 	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
 
-	pixman_box32_t *dst_rects = malloc(nrects * sizeof(pixman_box32_t));
+	pixman_box32_t stack_rects[REGION_STACK_RECTS];
+	pixman_box32_t *dst_rects = region_rects_alloc(stack_rects, nrects);
 	if (dst_rects == NULL) {
 		return;
 	}
@@ -100,9 +128,7 @@ void wlr_region_transform(pixman_region32_t *dst, pixman_region32_t *src,
 		}
 	}
 
-	pixman_region32_fini(dst);
-	pixman_region32_init_rects(dst, dst_rects, nrects);
-	free(dst_rects);
+	region_reset_rects(dst, dst_rects, nrects, stack_rects);
 }
 
 void wlr_region_expand(pixman_region32_t *dst, pixman_region32_t *src,
@@ -115,7 +141,8 @@ void wlr_region_expand(pixman_region32_t *dst, pixman_region32_t *src,
 	int nrects;
 	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
 
-	pixman_box32_t *dst_rects = malloc(nrects * sizeof(pixman_box32_t));
+	pixman_box32_t stack_rects[REGION_STACK_RECTS];
+	pixman_box32_t *dst_rects = region_rects_alloc(stack_rects, nrects);
 	if (dst_rects == NULL) {
 		return;
 	}
@@ -127,9 +154,7 @@ void wlr_region_expand(pixman_region32_t *dst, pixman_region32_t *src,
 		dst_rects[i].y2 = src_rects[i].y2 + distance;
 	}
 
-	pixman_region32_fini(dst);
-	pixman_region32_init_rects(dst, dst_rects, nrects);
-	free(dst_rects);
+	region_reset_rects(dst, dst_rects, nrects, stack_rects);
 }
 
 void wlr_region_rotated_bounds(pixman_region32_t *dst, pixman_region32_t *src,
@@ -142,7 +167,8 @@ void wlr_region_rotated_bounds(pixman_region32_t *dst, pixman_region32_t *src,
 	int nrects;
 	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
 
-	pixman_box32_t *dst_rects = malloc(nrects * sizeof(pixman_box32_t));
+	pixman_box32_t stack_rects[REGION_STACK_RECTS];
+	pixman_box32_t *dst_rects = region_rects_alloc(stack_rects, nrects);
 	if (dst_rects == NULL) {
 		return;
 	}
@@ -176,9 +202,7 @@ void wlr_region_rotated_bounds(pixman_region32_t *dst, pixman_region32_t *src,
 		dst_rects[i].y2 = ceil(oy + y2);
 	}
 
-	pixman_region32_fini(dst);
-	pixman_region32_init_rects(dst, dst_rects, nrects);
-	free(dst_rects);
+	region_reset_rects(dst, dst_rects, nrects, stack_rects);
 }
 
 static void region_confine(pixman_region32_t *region, double x1, double y1, double x2,
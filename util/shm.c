@@ -3,6 +3,7 @@
 #include <fcntl.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 #include <wlr/config.h>
@@ -18,17 +19,15 @@ static void randname(char *buf) {
 	}
 }
 
-int create_shm_file(void) {
+static int excl_shm_open(char *name) {
 	int retries = 100;
 	do {
-		char name[] = "/wlroots-XXXXXX";
 		randname(name + strlen(name) - 6);
 
 		--retries;
 		// CLOEXEC is guaranteed to be set by shm_open
 		int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
 		if (fd >= 0) {
-			shm_unlink(name);
 			return fd;
 		}
 	} while (retries > 0 && errno == EEXIST);
@@ -36,6 +35,16 @@ int create_shm_file(void) {
 	return -1;
 }
 
+int create_shm_file(void) {
+	char name[] = "/wlroots-XXXXXX";
+	int fd = excl_shm_open(name);
+	if (fd < 0) {
+		return -1;
+	}
+	shm_unlink(name);
+	return fd;
+}
+
 int allocate_shm_file(size_t size) {
 	int fd = create_shm_file();
 	if (fd < 0) {
@@ -53,3 +62,43 @@ int allocate_shm_file(size_t size) {
 
 	return fd;
 }
+
+bool allocate_shm_file_pair(size_t size, int *rw_fd_ptr, int *ro_fd_ptr) {
+	char name[] = "/wlroots-XXXXXX";
+	int rw_fd = excl_shm_open(name);
+	if (rw_fd < 0) {
+		return false;
+	}
+
+	// CLOEXEC is guaranteed to be set by shm_open
+	int ro_fd = shm_open(name, O_RDONLY, 0);
+	if (ro_fd < 0) {
+		shm_unlink(name);
+		close(rw_fd);
+		return false;
+	}
+
+	shm_unlink(name);
+
+	// Make sure the file cannot be re-opened in read-write mode (e.g. via
+	// "/proc/self/fd/" on Linux)
+	if (fchmod(rw_fd, 0) != 0) {
+		close(rw_fd);
+		close(ro_fd);
+		return false;
+	}
+
+	int ret;
+	do {
+		ret = ftruncate(rw_fd, size);
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0) {
+		close(rw_fd);
+		close(ro_fd);
+		return false;
+	}
+
+	*rw_fd_ptr = rw_fd;
+	*ro_fd_ptr = ro_fd;
+	return true;
+}
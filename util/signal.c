@@ -5,6 +5,20 @@ static void handle_noop(struct wl_listener *listener, void *data) {
 }
 
 void wlr_signal_emit_safe(struct wl_signal *signal, void *data) {
+	struct wl_list *head = &signal->listener_list;
+
+	/* Most signals have zero or one listener. A single listener can remove
+	 * itself or add new listeners (which must not be called) without any help,
+	 * since we don't look at the list anymore once it's been called. */
+	if (head->next == head) {
+		return;
+	}
+	if (head->next->next == head) {
+		struct wl_listener *l = wl_container_of(head->next, l, link);
+		l->notify(l, data);
+		return;
+	}
+
 	struct wl_listener cursor;
 	struct wl_listener end;
 
@@ -14,17 +28,24 @@ void wlr_signal_emit_safe(struct wl_signal *signal, void *data) {
 	 * function can remove any element it wants from the list without troubles.
 	 * wl_list_for_each_safe tries to be safe but it fails: it works fine
 	 * if the current item is removed, but not if the next one is. */
-	wl_list_insert(&signal->listener_list, &cursor.link);
+	wl_list_insert(head, &cursor.link);
 	cursor.notify = handle_noop;
-	wl_list_insert(signal->listener_list.prev, &end.link);
+	wl_list_insert(head->prev, &end.link);
 	end.notify = handle_noop;
 
 	while (cursor.link.next != &end.link) {
 		struct wl_list *pos = cursor.link.next;
 		struct wl_listener *l = wl_container_of(pos, l, link);
 
-		wl_list_remove(&cursor.link);
-		wl_list_insert(pos, &cursor.link);
+		/* Move the cursor past the listener about to be called. This is
+		 * wl_list_remove followed by wl_list_insert, without clearing the
+		 * cursor's links in between. */
+		cursor.link.prev->next = pos;
+		pos->prev = cursor.link.prev;
+		cursor.link.prev = pos;
+		cursor.link.next = pos->next;
+		pos->next->prev = &cursor.link;
+		pos->next = &cursor.link;
 
 		l->notify(l, data);
 	}
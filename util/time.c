@@ -0,0 +1,22 @@
+#define _POSIX_C_SOURCE 200112L
+#include <time.h>
+#include "util/time.h"
+
+static const long NSEC_PER_SEC = 1000000000;
+
+uint64_t timespec_to_nsec(const struct timespec *a) {
+	return (uint64_t)a->tv_sec * NSEC_PER_SEC + a->tv_nsec;
+}
+
+uint64_t get_current_time_nsec(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return timespec_to_nsec(&now);
+}
+
+int mhz_to_nsec(int mhz) {
+	if (mhz <= 0) {
+		return 0;
+	}
+	return 1000000000000LL / mhz;
+}
@@ -0,0 +1,175 @@
+#define _POSIX_C_SOURCE 200809L
+#include <inttypes.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+#include <wlr/util/trace.h>
+#include "util/time.h"
+#include "util/trace.h"
+
+struct trace_slot {
+	// Index of the event in the slot plus one, zero while being written
+	atomic_uint_fast64_t seq;
+	uint64_t time_nsec;
+	uint64_t arg;
+	enum wlr_trace_event event;
+};
+
+struct trace_event_info {
+	const char *name;
+	const char *category;
+	char phase; // Chrome trace event phase
+};
+
+static const struct trace_event_info event_info[] = {
+	[WLR_TRACE_SURFACE_COMMIT] = { "surface_commit", "surface", 'i' },
+	[WLR_TRACE_OUTPUT_COMMIT] = { "output_commit", "output", 'i' },
+	[WLR_TRACE_RENDER_BEGIN] = { "render", "render", 'B' },
+	[WLR_TRACE_RENDER_END] = { "render", "render", 'E' },
+	[WLR_TRACE_PAGE_FLIP] = { "page_flip", "output", 'i' },
+	[WLR_TRACE_POINTER_MOTION] = { "pointer_motion", "input", 'i' },
+	[WLR_TRACE_POINTER_BUTTON] = { "pointer_button", "input", 'i' },
+	[WLR_TRACE_POINTER_AXIS] = { "pointer_axis", "input", 'i' },
+	[WLR_TRACE_KEYBOARD_KEY] = { "keyboard_key", "input", 'i' },
+	[WLR_TRACE_TOUCH_DOWN] = { "touch_down", "input", 'i' },
+	[WLR_TRACE_TOUCH_UP] = { "touch_up", "input", 'i' },
+	[WLR_TRACE_TOUCH_MOTION] = { "touch_motion", "input", 'i' },
+	[WLR_TRACE_XWM_EVENT] = { "xwm_event", "xwayland", 'i' },
+};
+
+atomic_bool trace_enabled = false;
+
+static struct trace_slot *ring = NULL;
+static size_t ring_mask = 0;
+static atomic_uint_fast64_t ring_head;
+static char *dump_path = NULL;
+
+void trace_record(enum wlr_trace_event event, uint64_t arg) {
+	uint64_t idx = atomic_fetch_add_explicit(&ring_head, 1,
+		memory_order_relaxed);
+	struct trace_slot *slot = &ring[idx & ring_mask];
+	atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	slot->time_nsec = get_current_time_nsec();
+	slot->arg = arg;
+	slot->event = event;
+	atomic_store_explicit(&slot->seq, idx + 1, memory_order_release);
+}
+
+bool wlr_trace_init(size_t capacity) {
+	// The size is rounded up to a power of two
+	if (capacity > (size_t)1 << (sizeof(size_t) * CHAR_BIT - 1)) {
+		wlr_log(WLR_ERROR, "Trace ring buffer capacity %zu is too large",
+			capacity);
+		return false;
+	}
+
+	if (wlr_trace_is_enabled()) {
+		wlr_trace_finish();
+	}
+
+	size_t size = 1;
+	while (size < capacity) {
+		size <<= 1;
+	}
+
+	ring = calloc(size, sizeof(struct trace_slot));
+	if (ring == NULL) {
+		wlr_log(WLR_ERROR, "Failed to allocate trace ring buffer");
+		return false;
+	}
+	ring_mask = size - 1;
+	atomic_store(&ring_head, 0);
+	atomic_store(&trace_enabled, true);
+
+	wlr_log(WLR_INFO, "Tracing enabled, keeping the last %zu events", size);
+	return true;
+}
+
+void wlr_trace_finish(void) {
+	atomic_store(&trace_enabled, false);
+	free(ring);
+	ring = NULL;
+	ring_mask = 0;
+}
+
+bool wlr_trace_is_enabled(void) {
+	return atomic_load(&trace_enabled);
+}
+
+bool wlr_trace_dump(const char *path) {
+	if (!wlr_trace_is_enabled()) {
+		wlr_log(WLR_ERROR, "Cannot dump trace: tracing is disabled");
+		return false;
+	}
+
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		wlr_log_errno(WLR_ERROR, "Failed to open trace file %s", path);
+		return false;
+	}
+
+	uint64_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+	uint64_t size = ring_mask + 1;
+	uint64_t start = head > size ? head - size : 0;
+	pid_t pid = getpid();
+
+	fprintf(f, "{\"traceEvents\":[\n");
+	size_t written = 0;
+	for (uint64_t i = start; i < head; i++) {
+		struct trace_slot *slot = &ring[i & ring_mask];
+		if (atomic_load_explicit(&slot->seq, memory_order_acquire) != i + 1) {
+			continue;
+		}
+		struct trace_slot copy = {
+			.time_nsec = slot->time_nsec,
+			.arg = slot->arg,
+			.event = slot->event,
+		};
+		// Skip the event if it has been overwritten while being copied
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != i + 1 ||
+				copy.event >= WLR_TRACE_EVENT_LAST) {
+			continue;
+		}
+
+		const struct trace_event_info *info = &event_info[copy.event];
+		fprintf(f, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\","
+			"\"ts\":%" PRIu64 ".%03" PRIu64 ",\"pid\":%d,\"tid\":%d,%s"
+			"\"args\":{\"arg\":%" PRIu64 "}}",
+			written == 0 ? "" : ",\n", info->name, info->category, info->phase,
+			copy.time_nsec / 1000, copy.time_nsec % 1000, (int)pid, (int)pid,
+			info->phase == 'i' ? "\"s\":\"t\"," : "", copy.arg);
+		written++;
+	}
+	fprintf(f, "\n]}\n");
+
+	if (fclose(f) != 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to write trace file %s", path);
+		return false;
+	}
+	wlr_log(WLR_INFO, "Wrote %zu trace events to %s", written, path);
+	return true;
+}
+
+static int handle_dump_signal(int signal_number, void *data) {
+	wlr_trace_dump(dump_path);
+	return 0;
+}
+
+struct wl_event_source *wlr_trace_dump_on_signal(struct wl_event_loop *loop,
+		int signal_number, const char *path) {
+	char *path_copy = strdup(path);
+	if (path_copy == NULL) {
+		return NULL;
+	}
+	free(dump_path);
+	dump_path = path_copy;
+
+	return wl_event_loop_add_signal(loop, signal_number,
+		handle_dump_signal, NULL);
+}
@@ -0,0 +1,24 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "util/vec.h"
+
+void *vec_reserve_bytes(void *data, size_t *cap, size_t n, size_t elem_size) {
+	if (n <= *cap) {
+		return data;
+	}
+
+	size_t new_cap = *cap == 0 ? 4 : *cap;
+	while (new_cap < n) {
+		new_cap *= 2;
+	}
+	if (new_cap > SIZE_MAX / elem_size) {
+		return data;
+	}
+
+	void *new_data = realloc(data, new_cap * elem_size);
+	if (new_data == NULL) {
+		return data;
+	}
+	*cap = new_cap;
+	return new_data;
+}
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
@@ -75,36 +76,49 @@ static void xwm_selection_transfer_destroy_outgoing(
 static int xwm_data_source_read(int fd, uint32_t mask, void *data) {
 	struct wlr_xwm_selection_transfer *transfer = data;
 	struct wlr_xwm *xwm = transfer->selection->xwm;
+	size_t chunk_size = xwm->incr_chunk_size;
 
-	void *p;
-	size_t current = transfer->source_data.size;
-	if (transfer->source_data.size < INCR_CHUNK_SIZE) {
-		p = wl_array_add(&transfer->source_data, INCR_CHUNK_SIZE);
-		if (p == NULL) {
+	// The buffer is allocated once and reused for every chunk
+	if (transfer->source_data.alloc < chunk_size) {
+		size_t size = transfer->source_data.size;
+		if (wl_array_add(&transfer->source_data, chunk_size - size) == NULL) {
 			wlr_log(WLR_ERROR, "Could not allocate selection source_data");
 			goto error_out;
 		}
-	} else {
-		p = (char *)transfer->source_data.data + transfer->source_data.size;
+		transfer->source_data.size = size;
 	}
 
-	size_t available = transfer->source_data.alloc - current;
-	ssize_t len = read(fd, p, available);
-	if (len == -1) {
-		wlr_log(WLR_ERROR, "read error from data source: %m");
-		goto error_out;
-	}
+	// Fill the chunk as much as the source allows before handing it over to
+	// X11, instead of waiting for another event loop iteration per read
+	bool eof = false;
+	while (transfer->source_data.size < chunk_size) {
+		size_t available = chunk_size - transfer->source_data.size;
+		void *p = (char *)transfer->source_data.data +
+			transfer->source_data.size;
+		ssize_t len = read(fd, p, available);
+		if (len == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			break;
+		} else if (len == -1) {
+			wlr_log(WLR_ERROR, "read error from data source: %m");
+			goto error_out;
+		}
 
-	wlr_log(WLR_DEBUG, "read %zd bytes (available %zu, mask 0x%x)", len,
-		available, mask);
+		wlr_log(WLR_DEBUG, "read %zd bytes (available %zu, mask 0x%x)", len,
+			available, mask);
+
+		transfer->source_data.size += len;
+		if (len == 0) {
+			eof = true;
+			break;
+		}
+	}
 
-	transfer->source_data.size = current + len;
-	if (transfer->source_data.size >= INCR_CHUNK_SIZE) {
+	if (transfer->source_data.size >= chunk_size) {
 		if (!transfer->incr) {
 			wlr_log(WLR_DEBUG, "got %zu bytes, starting incr",
 				transfer->source_data.size);
 
-			size_t incr_chunk_size = INCR_CHUNK_SIZE;
+			uint32_t incr_chunk_size = chunk_size;
 			xcb_change_property(xwm->xcb_conn,
 				XCB_PROP_MODE_REPLACE,
 				transfer->request.requestor,
@@ -128,12 +142,12 @@ static int xwm_data_source_read(int fd, uint32_t mask, void *data) {
 				"property", transfer->source_data.size);
 			xwm_selection_flush_source_data(transfer);
 		}
-	} else if (len == 0 && !transfer->incr) {
+	} else if (eof && !transfer->incr) {
 		wlr_log(WLR_DEBUG, "non-incr transfer complete");
 		xwm_selection_flush_source_data(transfer);
 		xwm_selection_send_notify(xwm, &transfer->request, true);
 		xwm_selection_transfer_destroy_outgoing(transfer);
-	} else if (len == 0 && transfer->incr) {
+	} else if (eof && transfer->incr) {
 		wlr_log(WLR_DEBUG, "incr transfer complete");
 
 		transfer->flush_property_on_delete = true;
@@ -290,6 +304,7 @@ static void xwm_selection_send_data(struct wlr_xwm_selection *selection,
 	if (pipe(p) == -1) {
 		wlr_log(WLR_ERROR, "pipe() failed: %m");
 		xwm_selection_send_notify(selection->xwm, req, false);
+		free(transfer);
 		return;
 	}
 	fcntl(p[0], F_SETFD, FD_CLOEXEC);
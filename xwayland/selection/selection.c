@@ -180,6 +180,22 @@ void xwm_selection_init(struct wlr_xwm *xwm) {
 		xwm->atoms[CLIPBOARD_MANAGER],
 		XCB_TIME_CURRENT_TIME);
 
+	// Send selection data in chunks as large as a single ChangeProperty
+	// request allows, to keep the number of INCR round-trips low
+	size_t max_request_size =
+		(size_t)xcb_get_maximum_request_length(xwm->xcb_conn) * 4;
+	xwm->incr_chunk_size = INCR_CHUNK_SIZE;
+	if (max_request_size > INCR_CHUNK_SIZE +
+			sizeof(xcb_change_property_request_t)) {
+		xwm->incr_chunk_size =
+			max_request_size - sizeof(xcb_change_property_request_t);
+	}
+	if (xwm->incr_chunk_size > INCR_CHUNK_SIZE_MAX) {
+		xwm->incr_chunk_size = INCR_CHUNK_SIZE_MAX;
+	}
+	wlr_log(WLR_DEBUG, "Using %zu bytes selection INCR chunks",
+		xwm->incr_chunk_size);
+
 	selection_init(xwm, &xwm->clipboard_selection, xwm->atoms[CLIPBOARD]);
 	selection_init(xwm, &xwm->primary_selection, xwm->atoms[PRIMARY]);
 
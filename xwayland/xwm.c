@@ -3,6 +3,7 @@
 #endif
 #include <assert.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 #include <wlr/config.h>
 #include <wlr/types/wlr_surface.h>
@@ -14,6 +15,7 @@
 #include <xcb/render.h>
 #include <xcb/xfixes.h>
 #include "util/signal.h"
+#include "util/trace.h"
 #include "xwayland/xwm.h"
 
 const char *atom_map[ATOM_LAST] = {
@@ -93,16 +95,12 @@ struct wlr_xwayland_surface *wlr_xwayland_surface_from_wlr_surface(
 	return (struct wlr_xwayland_surface *)surface->role_data;
 }
 
-// TODO: replace this with hash table?
 static struct wlr_xwayland_surface *lookup_surface(struct wlr_xwm *xwm,
 		xcb_window_t window_id) {
-	struct wlr_xwayland_surface *surface;
-	wl_list_for_each(surface, &xwm->surfaces, link) {
-		if (surface->window_id == window_id) {
-			return surface;
-		}
+	if (window_id == XCB_WINDOW_NONE) {
+		return NULL;
 	}
-	return NULL;
+	return hash_map_get(&xwm->surfaces_by_id, window_id);
 }
 
 static int xwayland_surface_handle_ping_timeout(void *data) {
@@ -175,11 +173,21 @@ static struct wlr_xwayland_surface *xwayland_surface_create(
 	surface->ping_timer = wl_event_loop_add_timer(loop,
 		xwayland_surface_handle_ping_timeout, surface);
 	if (surface->ping_timer == NULL) {
+		wl_list_remove(&surface->link);
 		free(surface);
 		wlr_log(WLR_ERROR, "Could not add timer to event loop");
 		return NULL;
 	}
 
+	// Only make the surface visible to lookups once nothing can fail anymore
+	if (!hash_map_set(&xwm->surfaces_by_id, window_id, surface)) {
+		wl_event_source_remove(surface->ping_timer);
+		wl_list_remove(&surface->link);
+		free(surface);
+		wlr_log(WLR_ERROR, "Could not allocate wlr xwayland surface");
+		return NULL;
+	}
+
 	wlr_signal_emit_safe(&xwm->xwayland->events.new_surface, surface);
 
 	return surface;
@@ -329,6 +337,7 @@ static void xwayland_surface_destroy(
 		xwm_surface_activate(xsurface->xwm, NULL);
 	}
 
+	hash_map_remove(&xsurface->xwm->surfaces_by_id, xsurface->window_id);
 	wl_list_remove(&xsurface->link);
 	wl_list_remove(&xsurface->parent_link);
 
@@ -1295,66 +1304,117 @@ static void xwm_handle_unhandled_event(struct wlr_xwm *xwm, xcb_generic_event_t
 #endif
 }
 
+static void xwm_handle_event(struct wlr_xwm *xwm,
+		xcb_generic_event_t *event) {
+	switch (event->response_type & XCB_EVENT_RESPONSE_TYPE_MASK) {
+	case XCB_CREATE_NOTIFY:
+		xwm_handle_create_notify(xwm, (xcb_create_notify_event_t *)event);
+		break;
+	case XCB_DESTROY_NOTIFY:
+		xwm_handle_destroy_notify(xwm, (xcb_destroy_notify_event_t *)event);
+		break;
+	case XCB_CONFIGURE_REQUEST:
+		xwm_handle_configure_request(xwm,
+			(xcb_configure_request_event_t *)event);
+		break;
+	case XCB_CONFIGURE_NOTIFY:
+		xwm_handle_configure_notify(xwm,
+			(xcb_configure_notify_event_t *)event);
+		break;
+	case XCB_MAP_REQUEST:
+		xwm_handle_map_request(xwm, (xcb_map_request_event_t *)event);
+		break;
+	case XCB_MAP_NOTIFY:
+		xwm_handle_map_notify(xwm, (xcb_map_notify_event_t *)event);
+		break;
+	case XCB_UNMAP_NOTIFY:
+		xwm_handle_unmap_notify(xwm, (xcb_unmap_notify_event_t *)event);
+		break;
+	case XCB_PROPERTY_NOTIFY:
+		xwm_handle_property_notify(xwm,
+			(xcb_property_notify_event_t *)event);
+		break;
+	case XCB_CLIENT_MESSAGE:
+		xwm_handle_client_message(xwm, (xcb_client_message_event_t *)event);
+		break;
+	case XCB_FOCUS_IN:
+		xwm_handle_focus_in(xwm, (xcb_focus_in_event_t *)event);
+		break;
+	case 0:
+		xwm_handle_xcb_error(xwm, (xcb_value_error_t *)event);
+		break;
+	default:
+		xwm_handle_unhandled_event(xwm, event);
+		break;
+	}
+}
+
+static int64_t timespec_to_nsec(const struct timespec *a) {
+	return (int64_t)a->tv_sec * 1000000000 + a->tv_nsec;
+}
+
+static bool xwm_event_budget_exhausted(int count,
+		const struct timespec *start) {
+	if (count >= XWM_EVENT_BUDGET) {
+		return true;
+	}
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return timespec_to_nsec(&now) - timespec_to_nsec(start) >=
+		XWM_EVENT_TIME_BUDGET_NSEC;
+}
+
+/**
+ * Stop handling X11 events for this event loop iteration. The events left in
+ * the XCB queue are not signalled by the fd anymore, so ask for the writable
+ * state of the X11 connection as well: it's almost always set, and it makes
+ * the event loop call us back on its next iteration, after other clients have
+ * been dispatched.
+ */
+static void xwm_throttle_events(struct wlr_xwm *xwm) {
+	xwm->event_throttled = true;
+	xwm->throttle_count++;
+	wl_event_source_fd_update(xwm->event_source,
+		WL_EVENT_READABLE | WL_EVENT_WRITABLE);
+}
+
 static int x11_event_handler(int fd, uint32_t mask, void *data) {
 	int count = 0;
 	xcb_generic_event_t *event;
 	struct wlr_xwm *xwm = data;
 
+	if (xwm->event_throttled) {
+		xwm->event_throttled = false;
+		wl_event_source_fd_update(xwm->event_source, WL_EVENT_READABLE);
+	}
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
 	while ((event = xcb_poll_for_event(xwm->xcb_conn))) {
 		count++;
+		xwm->event_count[event->response_type & XCB_EVENT_RESPONSE_TYPE_MASK]++;
+		trace_point(WLR_TRACE_XWM_EVENT,
+			event->response_type & XCB_EVENT_RESPONSE_TYPE_MASK);
 
 		if (xwm->xwayland->user_event_handler &&
 				xwm->xwayland->user_event_handler(xwm, event)) {
 			break;
 		}
 
-		if (xwm_handle_selection_event(xwm, event)) {
-			free(event);
-			continue;
+		// Selection events count against the budget as well, so that a flood
+		// of them can't starve other clients
+		if (!xwm_handle_selection_event(xwm, event)) {
+			xwm_handle_event(xwm, event);
 		}
+		free(event);
 
-		switch (event->response_type & XCB_EVENT_RESPONSE_TYPE_MASK) {
-		case XCB_CREATE_NOTIFY:
-			xwm_handle_create_notify(xwm, (xcb_create_notify_event_t *)event);
-			break;
-		case XCB_DESTROY_NOTIFY:
-			xwm_handle_destroy_notify(xwm, (xcb_destroy_notify_event_t *)event);
-			break;
-		case XCB_CONFIGURE_REQUEST:
-			xwm_handle_configure_request(xwm,
-				(xcb_configure_request_event_t *)event);
-			break;
-		case XCB_CONFIGURE_NOTIFY:
-			xwm_handle_configure_notify(xwm,
-				(xcb_configure_notify_event_t *)event);
-			break;
-		case XCB_MAP_REQUEST:
-			xwm_handle_map_request(xwm, (xcb_map_request_event_t *)event);
-			break;
-		case XCB_MAP_NOTIFY:
-			xwm_handle_map_notify(xwm, (xcb_map_notify_event_t *)event);
-			break;
-		case XCB_UNMAP_NOTIFY:
-			xwm_handle_unmap_notify(xwm, (xcb_unmap_notify_event_t *)event);
-			break;
-		case XCB_PROPERTY_NOTIFY:
-			xwm_handle_property_notify(xwm,
-				(xcb_property_notify_event_t *)event);
-			break;
-		case XCB_CLIENT_MESSAGE:
-			xwm_handle_client_message(xwm, (xcb_client_message_event_t *)event);
-			break;
-		case XCB_FOCUS_IN:
-			xwm_handle_focus_in(xwm, (xcb_focus_in_event_t *)event);
-			break;
-		case 0:
-			xwm_handle_xcb_error(xwm, (xcb_value_error_t *)event);
-			break;
-		default:
-			xwm_handle_unhandled_event(xwm, event);
-			break;
+		if (xwm_event_budget_exhausted(count, &start)) {
+			xwm_throttle_events(xwm);
+			xcb_flush(xwm->xcb_conn);
+			// Returning zero stops the post-dispatch check loop
+			return 0;
 		}
-		free(event);
 	}
 
 	if (count) {
@@ -1463,6 +1523,16 @@ void xwm_destroy(struct wlr_xwm *xwm) {
 	if (xwm->event_source) {
 		wl_event_source_remove(xwm->event_source);
 	}
+	for (size_t i = 0; i <= XCB_EVENT_RESPONSE_TYPE_MASK; i++) {
+		if (xwm->event_count[i]) {
+			wlr_log(WLR_DEBUG, "Handled %"PRIu64" X11 events of type %zu",
+				xwm->event_count[i], i);
+		}
+	}
+	if (xwm->throttle_count) {
+		wlr_log(WLR_DEBUG, "X11 event handling was deferred %"PRIu64" times",
+			xwm->throttle_count);
+	}
 #if WLR_HAS_XCB_ERRORS
 	if (xwm->errors_context) {
 		xcb_errors_context_free(xwm->errors_context);
@@ -1477,6 +1547,7 @@ void xwm_destroy(struct wlr_xwm *xwm) {
 	}
 	wl_list_remove(&xwm->compositor_new_surface.link);
 	wl_list_remove(&xwm->compositor_destroy.link);
+	hash_map_finish(&xwm->surfaces_by_id);
 	xcb_disconnect(xwm->xcb_conn);
 
 	free(xwm);
@@ -1691,6 +1762,7 @@ struct wlr_xwm *xwm_create(struct wlr_xwayland *wlr_xwayland) {
 
 	xwm->xwayland = wlr_xwayland;
 	wl_list_init(&xwm->surfaces);
+	hash_map_init(&xwm->surfaces_by_id);
 	wl_list_init(&xwm->unpaired_surfaces);
 	xwm->ping_timeout = 10000;
 